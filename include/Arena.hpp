@@ -0,0 +1,59 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Arena.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 02:14:09 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 02:14:09 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef ARENA_HPP
+# define ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+
+// Bump-Allocator pro Verbindung fuer alles, was nur einen Request lang lebt
+// (aufgeloeste Pfade, Cookies). deallocate() tut nichts; reset() nach jedem
+// Request setzt nur den Zeiger zurueck und behaelt den groessten Block ->
+// im Keep-Alive-Dauerbetrieb kein malloc mehr.
+class Arena : public std::pmr::memory_resource
+{
+    public:
+        static const size_t FIRST_BLOCK = 4096;
+        static const size_t KEEP_MAX    = 64 * 1024;   // groessere Bloecke gibt reset() zurueck
+
+        Arena() : blocks(NULL), cur(NULL), end(NULL) {}
+        ~Arena();
+        // ConnTable setzt Slots per Zuweisung zurueck: tauschen, die alten Bloecke
+        // sterben erst mit dem Temporary (nach dem Request, der noch darauf zeigt)
+        Arena& operator=(Arena&& other) noexcept;
+
+        void reset();
+
+    private:
+        struct Block
+        {
+            Block* next;
+            size_t size;   // nutzbare Bytes hinter dem Kopf
+        };
+
+        Arena(const Arena&);
+        Arena& operator=(const Arena&);
+
+        void* do_allocate(size_t bytes, size_t align) override;
+        void  do_deallocate(void*, size_t, size_t) override {}
+        bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        void  grow(size_t need);
+        void  release(Block* keep);
+
+        Block* blocks;   // neuester (= groesster) zuerst
+        char*  cur;
+        char*  end;
+};
+
+#endif
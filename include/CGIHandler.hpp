@@ -15,8 +15,12 @@
 
 #include "HTTPHandler.hpp"
 #include "Response.hpp"
+#include "Compress.hpp"
 #include <string>
 #include <map>
+#include <memory>
+#include <sys/types.h>
+#include <spawn.h>
 
 enum CGI_Error
 {
@@ -26,16 +30,75 @@ enum CGI_Error
     CGI_SCRIPT_ERROR,
     CGI_FORK_ERROR,
     CGI_PIPE_ERROR,
-    CGI_EXEC_ERROR
+    CGI_EXEC_ERROR,
+    CGI_UPSTREAM_ERROR
 };
 
-struct CGIResult
+// Ergebnis von CGIHandler::parseHead
+enum CgiHead
 {
+    CGI_HEAD_MORE,    // Header-Block noch nicht komplett
+    CGI_HEAD_DONE,    // Header-Block geparst, Body ab body_off
+    CGI_HEAD_NONE     // Ausgabe hat keinen Header-Block -> alles ist Body
+};
+
+// Laufendes CGI-Script. Die Pipe-Enden sind non-blocking und haengen am
+// Reactor des Workers; der Server pumpt sie und baut am Ende mit
+// CGIHandler::finish() die Antwort.
+struct CgiJob
+{
+    enum Io { IO_AGAIN, IO_DONE, IO_ERROR };
+
+    pid_t       pid     = -1;
+    int         in_fd   = -1;     // stdin des Scripts (wir schreiben den Body)
+    int         out_fd  = -1;     // stdout des Scripts (wir lesen)
+    std::string input;            // Request-Body
+    size_t      in_off  = 0;
     std::string output;
-    int exit_status;
-    CGI_Error error;
-    
-    CGIResult() : exit_status(0), error(CGI_SUCCESS) {}
+    bool        exited  = false;  // per waitpid abgeholt bzw. FCGI_END_REQUEST da
+    CGI_Error   error   = CGI_SUCCESS;  // Lese-/waitpid-/Backend-Fehler
+    int         status  = 0;      // waitpid-Status bzw. FastCGI appStatus
+
+    // FastCGI: kein eigener Prozess, der Server schickt den Request ueber
+    // eine persistente Backend-Verbindung (siehe FastCGI.hpp)
+    std::string fastcgi;          // Adresse aus der Location, leer = fork/exec
+    bool        fastcgi_mpx = false;
+    std::map<std::string, std::string> params;
+
+    // cgi_pool: Script laeuft in einem vorgestarteten Interpreter (CgiPool.hpp)
+    const LocationConfig* pool = nullptr;
+
+    bool        inject_color = false;   // GET: --user-color wie bei statischem HTML
+    std::string color;
+
+    // Streaming (nur fork/exec): ist der Header-Block komplett und laeuft das
+    // Script danach weiter, geht der Kopf raus und stdout direkt an den Client
+    bool        keep_alive  = false;  // vom Request
+    bool        http11      = false;  // Client versteht chunked
+    long        head_ms     = 0;      // Header-Block komplett seit (0 = noch nicht)
+    bool        streaming   = false;  // Kopf ist eingereiht, Status steht fest
+    bool        chunked     = false;
+    size_t      stream_left = std::string::npos;  // Content-Length vom Script (npos = keine)
+    bool        paused      = false;  // Client-Puffer voll: stdout-Pipe nicht beim Reactor
+    bool        no_stream   = false;  // HTML mit --user-color braucht den ganzen Body
+
+    // gzip der Location: am Ende komprimieren bzw. beim Streamen durch den Deflater
+    const LocationConfig*     gzip = nullptr;
+    std::string               encoding;   // "gzip"/"deflate", leer = Client kann keins
+    std::unique_ptr<Deflater> deflater;
+
+    bool streamable() const { return fastcgi.empty() && !pool && !no_stream; }
+
+    CgiJob() {}
+    ~CgiJob();
+
+    Io   writeInput();   // bis EAGAIN oder alles geschrieben
+    Io   readOutput(size_t max = std::string::npos);   // bis EAGAIN, EOF oder max Bytes
+    bool reap();         // waitpid(WNOHANG), true sobald der Prozess weg ist
+
+    private:
+        CgiJob(const CgiJob&);
+        CgiJob& operator=(const CgiJob&);
 };
 
 class CGIHandler
@@ -44,18 +107,31 @@ public:
     CGIHandler();
     ~CGIHandler();
 
-    // Führt das CGI-Script aus und gibt HTTP-Response zurück
-    Response execute(const Request& req);
-    Response executeWith(const Request& req, const std::string& execPath, const std::string& scriptFile);
-    
+    // startet das Script ohne zu blockieren und haengt den Job an res.cgi;
+    // execPath leer -> Interpreter nach Endung bzw. Script direkt.
+    // false: res enthaelt bereits die Fehlerseite
+    bool start(const Request& req, const LocationConfig& config, const std::string& execPath,
+               const std::string& scriptFile, Response& res);
+    // wie start(), aber nur den Job fuer ein FastCGI-Backend vorbereiten
+    void startFastCgi(const Request& req, const LocationConfig& config, const std::string& scriptFile, Response& res);
+    // Job fuer einen Worker aus dem cgi_pool der Location vorbereiten
+    void startPooled(const Request& req, const LocationConfig& config, const std::string& scriptFile, Response& res);
+    // Antwort aus gesammelter Ausgabe + Exit-Status (Job muss abgeholt sein)
+    Response finish(CgiJob& job);
+    // Kopf einer gestreamten Antwort; nimmt den Header-Block aus job.output
+    Response beginStream(CgiJob& job);
+    // RFC 3875 6.2: Header-Block (Status, Location, Content-Type, ...) vor dem Body;
+    // content_length = Content-Length des Scripts oder npos
+    static CgiHead parseHead(const std::string& out, Response& res, size_t& body_off, size_t& content_length);
+    Response createErrorResponse(CGI_Error error, int script_exit_status = 0);
+
 private:
     // Hilfsfunktionen
-    std::map<std::string, std::string> buildEnv(const Request& req, const std::string& scriptPath);
-    CGIResult runCGI(const std::string& scriptPath, const std::map<std::string, std::string>& env, 
-                    const std::string& body, size_t timeout_ms);
-    
-    // Helper für Fehlerbehandlung
-    Response createErrorResponse(CGI_Error error, int script_exit_status = 0);
+    std::map<std::string, std::string> buildEnv(const Request& req, const LocationConfig& config, const std::string& scriptPath);
 };
 
+// posix_spawn-Attribute fuer Kindprozesse: leere Signalmaske, SIGPIPE wieder
+// auf Default (der Server ignoriert es)
+void init_spawn_attr(posix_spawnattr_t& attr);
+
 #endif
@@ -0,0 +1,88 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CgiPool.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 16:40:12 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 16:40:12 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CGIPOOL_HPP
+# define CGIPOOL_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "CGIHandler.hpp"
+#include "ConnTable.hpp"
+#include "config.hpp"
+
+// Vorgestartete Interpreter pro Location ("cgi_pool"), fuer Scripts, die
+// (noch) nicht als FastCGI-App laufen. Jeder Worker ist ein Python-Prozess,
+// der schon im Root der Location steht und Requests ueber ein socketpair
+// (fd 3) bekommt:
+//   Request: u32 env_len, u32 body_len, env ("K=V\0"...), body
+//   Antwort: i32 exit_code, u32 out_len, stdout des Scripts
+// Ein Worker bearbeitet immer nur einen Request; was keinen freien Worker
+// findet, wartet in der Queue.
+class CgiPool
+{
+    public:
+        struct Worker
+        {
+            pid_t                   pid  = -1;
+            int                     sock = -1;
+            std::shared_ptr<CgiJob> job;            // leer = frei
+            ConnHandle              client;
+            std::string             wbuf;
+            size_t                  woff = 0;
+            std::string             rbuf;
+            size_t                  served = 0;
+            long                    idle_since = 0;
+            bool                    writing = false; // IO_WRITE beim Reactor angemeldet
+            bool                    eof = false;     // Socket zu: nach der Antwort ersetzen
+        };
+
+        struct Pending
+        {
+            std::shared_ptr<CgiJob> job;
+            ConnHandle              client;
+        };
+
+        explicit CgiPool(const LocationConfig& loc);
+        ~CgiPool();
+
+        // Location hat cgi_pool und das Script laeuft mit einem Python-Interpreter
+        static bool handles(const LocationConfig& loc, const std::string& scriptFile);
+
+        const LocationConfig& location() const { return loc; }
+        bool     full() const { return workers.size() >= loc.cgi_pool; }
+        Worker*  spawn(long now_ms);      // NULL bei socketpair-/fork-Fehler
+        Worker*  idle();
+        Worker*  find(int sock);
+        Worker*  find(const CgiJob* job);
+        void     assign(Worker& w, const Pending& p);
+
+        CgiJob::Io onWritable(Worker& w);
+        CgiJob::Io onReadable(Worker& w);   // IO_DONE: Antwort steht im Job
+        void       release(Worker& w, long now_ms);
+        pid_t      retire(Worker* w, bool kill);   // Socket zu, pid zum Abholen
+
+        std::vector<std::unique_ptr<Worker> > workers;
+        std::deque<Pending>                   queue;
+
+    private:
+        CgiPool(const CgiPool&);
+        CgiPool& operator=(const CgiPool&);
+
+        const LocationConfig& loc;
+        std::string           interpreter;
+        std::string           root;
+};
+
+#endif
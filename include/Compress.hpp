@@ -0,0 +1,59 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compress.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 21:03:12 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 21:03:12 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef COMPRESS_HPP
+# define COMPRESS_HPP
+
+#include <string>
+#include <string_view>
+#include <zlib.h>
+#include "Response.hpp"
+#include "config.hpp"
+
+// zlib-Strom fuer gzip ("gzip") oder zlib-deflate ("deflate").
+// push() ohne finish macht Z_SYNC_FLUSH -> alles bisher Gelieferte ist beim
+// Client dekodierbar (wichtig fuer gestreamte CGI-Ausgabe)
+class Deflater
+{
+    public:
+        Deflater() : ready(false) {}
+        ~Deflater();
+
+        bool init(const std::string& coding, int level);
+        // haengt die komprimierten Bytes an out an
+        bool push(const char* data, size_t len, std::string& out, bool finish);
+
+    private:
+        Deflater(const Deflater&);
+        Deflater& operator=(const Deflater&);
+
+        z_stream zs;
+        bool     ready;
+};
+
+// Accept-Encoding: "gzip, br;q=0.5, *;q=0" -> darf coding benutzt werden?
+bool acceptsEncoding(std::string_view header, const char* coding);
+// gzip vor deflate; "" = keins von beiden
+std::string chooseEncoding(std::string_view accept_encoding);
+
+// "gzip on" + Status + Content-Type aus gzip_types, noch nicht kodiert, kein sendfile-Body
+bool gzipApplies(const LocationConfig& loc, const Response& res);
+// Vary-Token anhaengen, falls noch nicht da
+void addVary(Response& res, const std::string& token);
+
+// gepufferte Antwort komprimieren (ab gzip_min_length); Ergebnisse landen in
+// einem kleinen Cache pro Thread, Schluessel ist ein Hash ueber den Body ->
+// dieselbe Verzeichnisliste/Fehlerseite wird nicht jedes Mal neu komprimiert.
+// coding leer = Client kann nichts davon, nur Vary setzen
+void compressResponse(Response& res, const LocationConfig& loc, const std::string& coding);
+
+#endif
@@ -0,0 +1,133 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConnTable.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:02:17 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 11:02:17 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONNTABLE_HPP
+# define CONNTABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Handle auf eine Verbindung: fd + Generation.
+// Wird der fd geschlossen und neu vergeben, passt gen nicht mehr -> get() liefert NULL.
+struct ConnHandle
+{
+    int      fd  = -1;
+    uint32_t gen = 0;
+};
+
+// Slot-Tabelle fuer Verbindungen, Index = fd.
+// - Slots liegen in festen Seiten -> Objekte werden nie verschoben oder kopiert
+// - open/close/get sind O(1); die Freiliste ist der fd-Raum selbst (der Kernel
+//   vergibt immer den kleinsten freien fd, die Tabelle bleibt also dicht)
+// - active() ist eine dichte fd-Liste fuer Iteration (swap-remove beim Schliessen)
+template <typename T>
+class ConnTable
+{
+    public:
+        ConnTable() : count(0) {}
+
+        // belegt den Slot fuer fd mit einem frischen T
+        T* open(int fd)
+        {
+            if (fd < 0)
+                return NULL;
+            Slot& s = slot(fd, true);
+            if (s.pos >= 0)
+                close(fd);
+            s.value = T();
+            ++s.gen;
+            s.pos = static_cast<int>(live.size());
+            live.push_back(fd);
+            ++count;
+            return &s.value;
+        }
+
+        void close(int fd)
+        {
+            Slot* s = find(fd);
+            if (!s)
+                return;
+            int last = live.back();
+            live[s->pos] = last;
+            slot(last, false).pos = s->pos;
+            live.pop_back();
+            s->pos = -1;
+            s->value = T();   // Puffer sofort freigeben
+            --count;
+        }
+
+        T* get(int fd)
+        {
+            Slot* s = find(fd);
+            return s ? &s->value : NULL;
+        }
+
+        T* get(const ConnHandle& h)
+        {
+            Slot* s = find(h.fd);
+            return (s && s->gen == h.gen) ? &s->value : NULL;
+        }
+
+        ConnHandle handle(int fd)
+        {
+            ConnHandle h;
+            Slot* s = find(fd);
+            if (s)
+            {
+                h.fd = fd;
+                h.gen = s->gen;
+            }
+            return h;
+        }
+
+        size_t size() const { return count; }
+        const std::vector<int>& active() const { return live; }
+
+    private:
+        enum { PAGE_SHIFT = 8, PAGE_SIZE = 1 << PAGE_SHIFT };
+
+        struct Slot
+        {
+            T        value;
+            uint32_t gen = 0;
+            int      pos = -1;   // Index in live, -1 = frei
+        };
+
+        Slot& slot(int fd, bool grow)
+        {
+            size_t page = static_cast<size_t>(fd) >> PAGE_SHIFT;
+            if (grow && page >= pages.size())
+                pages.resize(page + 1);
+            if (grow && !pages[page])
+                pages[page].reset(new Slot[PAGE_SIZE]);
+            return pages[page][fd & (PAGE_SIZE - 1)];
+        }
+
+        Slot* find(int fd)
+        {
+            if (fd < 0)
+                return NULL;
+            size_t page = static_cast<size_t>(fd) >> PAGE_SHIFT;
+            if (page >= pages.size() || !pages[page])
+                return NULL;
+            Slot& s = pages[page][fd & (PAGE_SIZE - 1)];
+            return (s.pos >= 0) ? &s : NULL;
+        }
+
+        std::vector<std::unique_ptr<Slot[]> > pages;
+        std::vector<int> live;
+        size_t count;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 15:02:11 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 15:02:11 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FASTCGI_HPP
+# define FASTCGI_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "CGIHandler.hpp"
+#include "ConnTable.hpp"
+
+// FastCGI 1.0 Record-Typen (nur was ein Responder-Client braucht)
+enum FcgiType
+{
+    FCGI_BEGIN_REQUEST = 1,
+    FCGI_ABORT_REQUEST = 2,
+    FCGI_END_REQUEST   = 3,
+    FCGI_PARAMS        = 4,
+    FCGI_STDIN         = 5,
+    FCGI_STDOUT        = 6,
+    FCGI_STDERR        = 7
+};
+
+// Eine persistente Verbindung zu einem FastCGI-Backend (unix:/pfad oder host:port).
+// Requests laufen mit FCGI_KEEP_CONN und eigener Request-ID; mit "multiplex"
+// teilen sich beliebig viele Requests die Verbindung, sonst (z.B. php-fpm)
+// laeuft pro Verbindung immer nur einer.
+class FcgiConn
+{
+    public:
+        struct Slot
+        {
+            std::shared_ptr<CgiJob> job;
+            ConnHandle              client;
+            bool                    aborted = false;  // Client weg, Ende abwarten
+        };
+
+        FcgiConn(const std::string& addr, bool mpx);
+        ~FcgiConn();
+
+        bool connect();                 // non-blocking; false = sofort gescheitert
+        int  fd() const { return sock; }
+        bool ready() const { return connected; }
+        const std::string& address() const { return addr; }
+        bool accepts() const { return mpx || slots.empty(); }
+        bool wantsWrite() const { return !connected || woff < wbuf.size(); }
+        const std::map<uint16_t, Slot>& active() const { return slots; }
+
+        void submit(const std::shared_ptr<CgiJob>& job, ConnHandle client);
+        bool abort(const CgiJob* job);  // FCGI_ABORT_REQUEST; true wenn der Job hier lief
+
+        // false = Verbindung ist hin (danach failAll + schliessen)
+        bool onWritable();
+        bool onReadable(std::vector<Slot>& done);
+        void failAll(std::vector<Slot>& out);
+
+        bool writing = false;           // IO_WRITE beim Reactor angemeldet
+
+    private:
+        FcgiConn(const FcgiConn&);
+        FcgiConn& operator=(const FcgiConn&);
+
+        bool parse(std::vector<Slot>& done);
+
+        std::string addr;
+        bool        mpx;
+        int         sock;
+        bool        connected;
+        std::string wbuf;
+        size_t      woff;
+        std::string rbuf;
+        uint16_t    next_id;
+        std::map<uint16_t, Slot> slots;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileCache.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 19:12:40 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 19:12:40 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FILECACHE_HPP
+# define FILECACHE_HPP
+
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <sys/types.h>
+#include "Response.hpp"
+
+struct ServerConfig;
+
+// Was ein GET ueber eine Datei wissen muss; Momentaufnahme, wird bei einer
+// Aenderung ersetzt statt veraendert
+struct FileInfo
+{
+    int    err    = 0;        // errno von open/stat (0 = gibt es)
+    bool   is_dir = false;
+    bool   is_reg = false;
+    off_t  size   = 0;
+    time_t mtime  = 0;
+    long   mtime_ns = 0;
+    ino_t  ino    = 0;
+    dev_t  dev    = 0;
+    std::shared_ptr<FileRef> file;   // offen (nur regulaere, lesbare Dateien; bei lookup() ohne Cache nie)
+    std::string etag;            // etagFor(), einmal pro Momentaufnahme
+    std::string last_modified;   // httpDate(mtime)
+};
+
+// Wie nginx' open_file_cache: Pfad -> Metadaten + offener fd, pro Worker-Thread.
+// Innerhalb von open_file_cache_valid kostet ein Treffer keinen Syscall, der
+// fd geht direkt an sendfile. Danach prueft ein stat(), ob die Datei noch
+// dieselbe ist (inode, Groesse, mtime). Ungenutzte Eintraege fliegen nach
+// "inactive" raus, bei mehr als max der am laengsten ungenutzte.
+// Ist der Cache aus (open_file_cache off), macht lookup() nur ein stat();
+// geoeffnet wird erst mit open(), wenn wirklich ein Body rausgeht.
+class OpenFileCache
+{
+    public:
+        static OpenFileCache& local();
+
+        // Schluessel ist der fertig aufgeloeste Pfad (root + URL); remember_errors
+        // merkt "gibt es nicht" auch ohne open_file_cache_errors (z.B. fuer .gz-Nachbarn)
+        std::shared_ptr<const FileInfo> lookup(std::string_view path, bool remember_errors = false);
+        // wie lookup(), aber mit offenem fd in FileInfo::file (falls lesbar)
+        std::shared_ptr<const FileInfo> open(std::string_view path);
+        // nach eigenen Schreibzugriffen (Upload, DELETE)
+        void clear();
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<const FileInfo> info;
+            long checked_ms = 0;
+            long used_ms    = 0;
+            std::list<std::string>::iterator lru;
+        };
+
+        OpenFileCache() {}
+        OpenFileCache(const OpenFileCache&);
+        OpenFileCache& operator=(const OpenFileCache&);
+
+        void expire(long now_ms);
+
+        std::unordered_map<std::string, Entry> entries;
+        std::list<std::string>                 lru;   // vorne = zuletzt benutzt
+        std::string                            key;   // Suchschluessel, Kapazitaet bleibt -> Treffer ohne malloc
+};
+
+// Kleine Datei komplett im Speicher, samt fertiger Header-Werte
+struct CachedFile
+{
+    std::string body;
+    std::string type;            // Content-Type
+    std::string length;          // Content-Length
+    std::string etag;            // siehe etagFor()
+    std::string last_modified;   // HTTP-Datum
+    time_t mtime    = 0;
+    long   mtime_ns = 0;
+    off_t  size     = 0;
+    ino_t  ino      = 0;
+    dev_t  dev      = 0;
+};
+
+// content_cache <budget> [max_file] (pro server-Block, pro Worker-Thread):
+// LRU ueber kleine statische Dateien. Ein Treffer braucht weder read() noch
+// Header-Aufbereitung. Ob der Eintrag noch stimmt, entscheidet die FileInfo
+// aus dem open_file_cache (inode, Groesse, mtime) -> Aenderungen werden
+// spaetestens nach open_file_cache_valid sichtbar.
+class ContentCache
+{
+    public:
+        static ContentCache& local(const ServerConfig& srv);
+
+        // nullptr = aus, zu gross, keine regulaere Datei oder nicht lesbar;
+        // mime() wird nur beim Laden aufgerufen
+        std::shared_ptr<const CachedFile> get(std::string_view path, const FileInfo& info,
+                                              const std::string& (*mime)(std::string_view));
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<const CachedFile> file;
+            size_t cost = 0;
+            std::list<std::string>::iterator lru;
+        };
+
+        ContentCache(size_t budget, size_t max_file) : budget(budget), max_file(max_file), used(0) {}
+        ContentCache(const ContentCache&);
+        ContentCache& operator=(const ContentCache&);
+
+        void drop(std::unordered_map<std::string, Entry>::iterator it);
+
+        size_t budget;
+        size_t max_file;
+        size_t used;
+        std::unordered_map<std::string, Entry> entries;
+        std::list<std::string>                 lru;   // vorne = zuletzt benutzt
+        std::string                            key;
+};
+
+// HTTP-Datum (RFC 7231, IMF-fixdate) und zurueck (-1 = kein gueltiges Datum)
+std::string httpDate(time_t t);
+time_t parseHttpDate(const std::string& s);
+// starker Validator aus inode, Groesse und mtime (s.ns): "2a41c-e71-6943ab7f.1b2e0a40"
+std::string etagFor(const FileInfo& info);
+
+#endif
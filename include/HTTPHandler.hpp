@@ -14,11 +14,27 @@
 # define HTTPHANDLER_HPP
 
 #include <string>
+#include <string_view>
 #include <map>
+#include <memory_resource>
 #include "config.hpp"
+#include "Headers.hpp"
+
+// Zustand des chunked Decoders, lebt im Client zwischen zwei Reads
+enum class ChunkState { SIZE, DATA, CRLF_AFTER_DATA, TRAILER, DONE };
 
 struct Request
 {
+	// mr: Speicher fuer Request-lokale Daten (Cookies, aufgeloeste Pfade), beim
+	// Client dessen Arena; Kopien landen wieder auf dem Heap
+	explicit Request(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+		: cookies(mr) {}
+	// fuer den naechsten Request auf derselben Verbindung; Puffer behalten ihre
+	// Kapazitaet, Cookies sind danach leer (vor Arena::reset() aufrufen)
+	void reset();
+	// pmr-Allokatoren wandern bei Zuweisungen nicht mit -> bleibt die eigene Arena
+	std::pmr::memory_resource* arena() const { return cookies.get_allocator().resource(); }
+
 	// Verbindungsdaten
 	bool keep_alive = false; // aus Version+Header abgeleitet
 	int conn_fd = -1; // -1 heist, keine verbindung
@@ -31,8 +47,8 @@ struct Request
 	std::string path;
 	std::string version;
 	std::string query;
-	std::map<std::string, std::string> cookies;
-	std::map<std::string, std::string> headers;
+	std::pmr::map<std::pmr::string, std::pmr::string, std::less<> > cookies;
+	HeaderMap headers;
 	std::string body;
 };
 
@@ -42,10 +58,16 @@ class RequestParser
 		RequestParser();
 		~RequestParser();
 
-    bool parseHeaders(const std::string& rawHeaders, Request& req);
-    bool parseBody(std::istringstream& stream, Request& req, const LocationConfig& locationConfig, const ServerConfig& serverConfig);
+    // rawHeaders: Request-Line + Header bis vor die Leerzeile, direkt aus dem Empfangspuffer
+    bool parseHeaders(std::string_view rawHeaders, Request& req);
+    // Framing bestimmen (chunked / Content-Length) und gegen maxBody pruefen, setzt req.error
+    bool prepareBody(Request& req, size_t maxBody);
+    // dekodiert so viel von in wie moeglich nach req.body, used = verbrauchte Bytes;
+    // fertig wenn state == DONE, false bei Fehler (req.error = 400/413)
+    bool decodeChunks(std::string_view in, size_t& used, ChunkState& state, size_t& need,
+                      Request& req, size_t maxBody);
 	private:
-		void parseRequestLine(const std::string& line, Request& req);
-		void parseHeaderLine(const std::string& line, Request& req);
+		bool parseRequestLine(std::string_view line, Request& req);
+		void parseHeaderLine(std::string_view line, Request& req);
 };
 #endif
@@ -0,0 +1,110 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Headers.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 23:41:27 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 23:41:27 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef HEADERS_HPP
+# define HEADERS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// haeufige Header als feste IDs: Vergleich per Zahl statt String, Name kommt
+// beim Ausgeben aus der Tabelle (kanonische Schreibweise)
+enum HeaderId : unsigned char
+{
+    H_OTHER = 0,
+    H_ACCEPT_ENCODING,
+    H_ACCEPT_RANGES,
+    H_CONNECTION,
+    H_CONTENT_ENCODING,
+    H_CONTENT_LENGTH,
+    H_CONTENT_RANGE,
+    H_CONTENT_TYPE,
+    H_COOKIE,
+    H_ETAG,
+    H_HOST,
+    H_IF_MODIFIED_SINCE,
+    H_IF_NONE_MATCH,
+    H_IF_RANGE,
+    H_KEEP_ALIVE,
+    H_LAST_MODIFIED,
+    H_LOCATION,
+    H_RANGE,
+    H_SERVER,
+    H_TRANSFER_ENCODING,
+    H_VARY,
+    H_COUNT
+};
+
+const char* headerName(HeaderId id);
+// Gross-/Kleinschreibung egal; unbekannt -> H_OTHER
+HeaderId    headerId(std::string_view name);
+
+// Header-Felder eines Requests/einer Response ohne eigene Allokationen:
+// bis zu 16 Felder und 1 KB Namen+Werte liegen im Objekt selbst, erst
+// darueber hinaus geht es auf den Heap. Namen vergleichen case-insensitiv,
+// Reihenfolge = Einfuegereihenfolge. Ein Name kommt hoechstens einmal vor
+// (set() ersetzt). get() liefert Views, die bis zur naechsten Aenderung gelten.
+class HeaderMap
+{
+    public:
+        static const size_t INLINE_FIELDS = 16;
+        static const size_t INLINE_BYTES  = 1024;
+
+        HeaderMap() : count(0), used(0) {}
+
+        bool             has(HeaderId id) const { return find(id) >= 0; }
+        bool             has(std::string_view name) const { return find(name) >= 0; }
+        std::string_view get(HeaderId id) const;          // "" wenn nicht da
+        std::string_view get(std::string_view name) const;
+
+        void set(HeaderId id, std::string_view value);
+        void set(std::string_view name, std::string_view value);
+        void erase(HeaderId id);
+        void erase(std::string_view name);
+        void clear();
+
+        size_t           size() const { return count; }
+        std::string_view name(size_t i) const;
+        std::string_view value(size_t i) const;
+        // "Name: Wert\r\n" fuer alle Felder
+        void             appendTo(std::string& out) const;
+
+    private:
+        struct Field
+        {
+            HeaderId id;
+            uint32_t name_off;   // nur fuer H_OTHER
+            uint32_t name_len;
+            uint32_t val_off;
+            uint32_t val_len;
+        };
+
+        int          find(HeaderId id) const;
+        int          find(std::string_view name) const;
+        Field&       field(size_t i) { return i < INLINE_FIELDS ? inl[i] : more[i - INLINE_FIELDS]; }
+        const Field& field(size_t i) const { return i < INLINE_FIELDS ? inl[i] : more[i - INLINE_FIELDS]; }
+        const char*  bytes() const { return heap.empty() ? buf : heap.data(); }
+        uint32_t     store(std::string_view s);
+        void         push(const Field& f);
+        void         remove(int i);
+
+        Field              inl[INLINE_FIELDS];
+        std::vector<Field> more;
+        size_t             count;
+        char               buf[INLINE_BYTES];
+        size_t             used;
+        std::string        heap;   // nicht leer = alle Bytes liegen hier
+};
+
+#endif
@@ -0,0 +1,47 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationTrie.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 22:10:41 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 22:10:41 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef LOCATIONTRIE_HPP
+# define LOCATIONTRIE_HPP
+
+#include <string>
+#include <vector>
+
+struct LocationConfig;
+
+// Longest-Prefix-Match ueber die location-Pfade eines server-Blocks.
+// Radix-Trie (Kanten tragen ganze Teilstrings) in einem flachen vector,
+// damit ServerConfig kopierbar bleibt. Wird einmal nach dem Parsen gebaut,
+// match() kostet O(Laenge des Pfads) statt eines Vergleichs pro Location.
+class LocationTrie
+{
+    public:
+        void build(const std::vector<LocationConfig>& locations);
+        // Index in locations; passt kein Praefix: die "/"-Location bzw. die erste
+        size_t match(const std::string& path) const;
+
+    private:
+        struct Node
+        {
+            std::string label;
+            std::vector<std::pair<unsigned char, int> > kids;   // nach erstem Zeichen sortiert
+            int loc = -1;
+        };
+
+        int  child(int node, unsigned char c) const;
+        void insert(const std::string& key, int loc);
+
+        std::vector<Node> nodes;
+        size_t fallback = 0;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Reactor.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 10:12:41 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 10:12:41 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef REACTOR_HPP
+# define REACTOR_HPP
+
+#include <string>
+#include <vector>
+#include <poll.h>
+#ifdef __linux__
+# include <sys/epoll.h>
+#endif
+
+// Event-Bits, unabhaengig vom Backend
+enum IoEvent
+{
+    IO_READ  = 1 << 0,
+    IO_WRITE = 1 << 1,
+    IO_ERROR = 1 << 2,  // HUP / ERR / NVAL
+    IO_EXCLUSIVE = 1 << 3 // nur add(): von mehreren Prozessen geteilter Listener, nur einen wecken (epoll)
+};
+
+struct IoReady
+{
+    int      fd;
+    unsigned events;
+};
+
+// Interface fuer den Event-Loop in Server::run.
+// poll  -> level-triggered, O(n) pro wait
+// epoll -> edge-triggered, O(ready) pro wait; Handler muessen bis EAGAIN lesen/schreiben
+class Reactor
+{
+    public:
+        virtual ~Reactor() {}
+
+        virtual bool add(int fd, unsigned events) = 0;
+        virtual bool modify(int fd, unsigned events) = 0;
+        virtual void remove(int fd) = 0;
+
+        // wartet max. timeout_ms (-1 = unendlich), fuellt out; Rueckgabe < 0 bei Fehler
+        virtual int  wait(std::vector<IoReady>& out, int timeout_ms) = 0;
+        virtual const char* name() const = 0;
+
+        // "epoll" oder "poll"; unbekannt/nicht verfuegbar -> poll
+        static Reactor* create(const std::string& backend);
+};
+
+class PollReactor : public Reactor
+{
+    public:
+        bool add(int fd, unsigned events);
+        bool modify(int fd, unsigned events);
+        void remove(int fd);
+        int  wait(std::vector<IoReady>& out, int timeout_ms);
+        const char* name() const { return "poll"; }
+
+    private:
+        std::vector<pollfd> fds;
+        std::vector<int>    slot_by_fd; // fd -> Index in fds (-1 = nicht registriert)
+};
+
+#ifdef __linux__
+class EpollReactor : public Reactor
+{
+    public:
+        EpollReactor();
+        ~EpollReactor();
+
+        bool ok() const { return epfd >= 0; }
+        bool add(int fd, unsigned events);
+        bool modify(int fd, unsigned events);
+        void remove(int fd);
+        int  wait(std::vector<IoReady>& out, int timeout_ms);
+        const char* name() const { return "epoll"; }
+
+    private:
+        EpollReactor(const EpollReactor&);
+        EpollReactor& operator=(const EpollReactor&);
+
+        int epfd;
+        std::vector<epoll_event> evbuf;
+};
+#endif
+
+#endif
@@ -15,17 +15,59 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <string_view>
+#include <sys/types.h>
 #include "HTTPHandler.hpp"
 
+struct CgiJob;
+
+// offener fd fuer einen dateibasierten Body; schliesst sich selbst,
+// sobald die letzte Response/der letzte Client ihn loslaesst
+struct FileRef
+{
+	int fd;
+
+	explicit FileRef(int f) : fd(f) {}
+	~FileRef();
+
+	private:
+		FileRef(const FileRef&);
+		FileRef& operator=(const FileRef&);
+};
+
 struct Response
 {
 	int statusCode;
 	std::string reasonPhrase;
-	std::map<std::string, std::string> headers;
+	HeaderMap headers;
 	std::string body;
+	// fertiger Body aus dem content_cache: geteilt statt kopiert (body bleibt dann leer);
+	// wer den Body veraendert, holt ihn vorher mit ownBody() nach body
+	std::shared_ptr<const std::string> body_ref;
 	bool keep_alive = false;
 	std::vector<std::string> set_cookies;
 
+	// Body aus Datei (statt body): wird nach den Headern per sendfile() geschickt
+	std::shared_ptr<FileRef> file;
+	off_t file_offset = 0;
+	size_t file_length = 0;
+	// multipart/byteranges aus der Datei: je Teil Kopf + Abschnitt, body ist dann die Schluss-Boundary
+	struct FilePart
+	{
+		std::string head;
+		off_t off;
+		size_t len;
+	};
+	std::vector<FilePart> file_parts;
+
+	// CGI laeuft noch: Server haengt die Pipes an den Reactor, Antwort folgt spaeter
+	std::shared_ptr<CgiJob> cgi;
+
+	std::string headerBlock() const;   // Statuszeile + Header + Leerzeile, ohne Body
+	void headerBlock(std::string& out) const;   // dasselbe, an out angehaengt
+	void ownBody();
+	size_t bodySize() const { return body_ref ? body_ref->size() : body.size(); }
 	std::string toString() const;
 	void setCookie(const std::string& name, const std::string& value, const std::string& path = "/", int maxAge = -1, bool httpOnly = false,
                    const std::string& sameSite = "");
@@ -39,20 +81,35 @@ class ResponseHandler
 
 		Response handleRequest(const Request& req, const LocationConfig& locConfig, const ServerConfig& serverConfig);  // Neu: + serverConfig
 		Response makeHtmlResponse(int status, const std::string& body);
+		// <body style="--user-color: ..."> in text/html einsetzen
+		static void injectUserColor(Response& res, const std::string& color);
 
 	private:
 		std::string getStatusMessage(int code);
 		// Unter public: oder private: in class ResponseHandler
-		std::string loadErrorPage(const std::string& errorPath, const std::string& fallbackHtml);
-		std::string readFile(const std::string& path);
-		bool fileExists(const std::string& path);
+		void loadErrorPage(const std::string& errorPath, std::string_view fallbackHtml,
+		                   const ServerConfig& serverConfig, Response& res);
+		std::string readFile(std::string_view path);
+		bool openFileBody(std::string_view path, Response& res);
+		bool cachedFileBody(std::string_view path, const ServerConfig& serverConfig, Response& res);
+		bool servePrecompressed(const Request& req, std::string_view fsPath, const LocationConfig& config,
+		                        const ServerConfig& serverConfig, Response& res);
+		bool fileExists(std::string_view path);
 		Response& methodGET(const Request& req, Response& res, const LocationConfig& config, const ServerConfig& serverConfig);
 		Response& methodPOST(const Request& req, Response& res, const LocationConfig& config);
 		Response& methodDELETE(const Request& req, Response& res, const LocationConfig& config);
-		bool handleDirectoryRequest(const std::string& url, const std::string& fsPath,
-                                   const LocationConfig& config, Response& res);
-		bool handleFileOrCgi(const Request& req, const std::string& fsPath,
-                            const LocationConfig& config, Response& res);
+		bool handleDirectoryRequest(const Request& req, std::string_view url, std::string_view fsPath,
+                                   const LocationConfig& config, const ServerConfig& serverConfig,
+                                   Response& res);
+		bool handleFileOrCgi(const Request& req, std::string_view fsPath,
+                            const LocationConfig& config, const ServerConfig& serverConfig,
+                            Response& res);
+		// 200 mit ETag/Last-Modified -> 304, wenn der Client die Version schon hat
+		void checkNotModified(const Request& req, Response& res);
+		// Range/If-Range -> 206 (ein Bereich oder multipart/byteranges) bzw. 416
+		void applyRange(const Request& req, Response& res);
+		// gzip/deflate nach Accept-Encoding (gzip on in der Location)
+		void compressOutput(const Request& req, const LocationConfig& locConfig, Response& res);
 		void validateBodySize(const LocationConfig& locConfig, const ServerConfig& serverConfig);
 	};
 
@@ -20,6 +20,7 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
@@ -28,12 +29,23 @@
 #include <netinet/in.h>
 #include <poll.h>
 #include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <unordered_map>
 #include <sstream>
 
+#include "Arena.hpp"
+#include "CGIHandler.hpp"
+#include "CgiPool.hpp"
+#include "ConnTable.hpp"
+#include "FastCGI.hpp"
 #include "HTTPHandler.hpp"
+#include "Reactor.hpp"
 #include "Response.hpp"
+#include "TimerQueue.hpp"
+#include "TxQueue.hpp"
+#include "VhostTable.hpp"
 #include "config.hpp"
 
 enum class RxState { READING_HEADERS, READING_BODY, READY };
@@ -41,7 +53,12 @@ enum class RxState { READING_HEADERS, READING_BODY, READY };
 struct Client
 {
     std::string rx; // Rohpuffer: während Header-Phase: Headerbytes; ab Body-Phase: Body/Reste
-    std::string tx; // Antwort
+    TxQueue txq;    // Antworten: Header, Body, ggf. Dateiabschnitt (writev/sendfile)
+    size_t inflight   = 0;       // Antworten in txq, noch nicht komplett gesendet
+    bool close_after  = false;   // Antwort ohne keep-alive eingereiht -> danach schliessen
+    bool peer_eof     = false;   // Peer hat die Schreibseite zu, rx noch abarbeiten
+    bool writing      = false;   // IO_WRITE beim Reactor angemeldet
+    std::shared_ptr<CgiJob> cgi; // laufendes CGI; blockiert weitere Requests (Reihenfolge)
 
     // Request-Empfang
     RxState state       = RxState::READING_HEADERS;
@@ -49,6 +66,11 @@ struct Client
     bool is_chunked     = false;
     size_t content_len  = 0;     // nur wenn Content-Length vorhanden
     size_t body_rcvd    = 0;     // gezählt (für CL und dechunk)
+    size_t scan_pos     = 0;     // bis hier wurde rx schon nach dem Terminator durchsucht
+    size_t body_start   = 0;     // Offset des Bodys in rx (nach "\r\n\r\n")
+    Arena arena;                 // Request-lokaler Speicher, reset nach jedem Request (vor req deklariert)
+    Request req{&arena};         // ab header_done: geparste Request-Line + Header
+    const LocationConfig* loc = nullptr; // aufgeloeste Location zu req.path
 
     // Limits (später aus Config)
     size_t max_header_bytes = 16 * 1024;       // 16KB
@@ -56,20 +78,21 @@ struct Client
 
     // Timeout
     long last_active_ms = 0;
+    long timer_ms       = 0;     // Deadline des scharfen TimerQueue-Eintrags (0 = keiner)
 
     std::string method, target, version;
     std::map<std::string,std::string> headers; // optional, später füllen
     bool keep_alive = false;
 
     // Chunked-Decoder-Context
-    enum class ChunkState { SIZE, DATA, CRLF_AFTER_DATA, DONE };
     ChunkState ch_state = ChunkState::SIZE;
     size_t     ch_need  = 0;   // noch zu lesende Bytes im DATA-State
 
     // ==== NEU: für Config-Routing ====
     int listen_port = 0;          // vom Listener übernommen
     size_t server_idx = 0;        // welcher Server-Block (wird ggf. nach Host-Header präzisiert)
-    std::string host;             // aus "Host:" Header (ggf. mit :port, vorher strippen)
+    std::string host;             // Host-Header, zu dem server_idx gehoert (roh, mit :port)
+    bool host_known = false;      // host/server_idx gueltig -> naechster Request mit gleichem Host spart den Lookup
 };
 
 struct HeadInfo
@@ -82,21 +105,87 @@ struct HeadInfo
     size_t content_length = 0;
 };
 
+// Ein Server-Objekt = ein Worker mit eigenem Reactor, eigenen Listenern
+// und eigener Verbindungstabelle. Bei worker_threads > 1 laeuft pro Thread eines.
 class Server
 {
     public:
+        Server(int worker_id = 0, bool reuse_port = false);
+
         int run(int argc, char* argv[]);
+        int serve();
+        int runMaster();
 
     private:
+        Server(const Server&);
+        Server& operator=(const Server&);
+
         void loadConfig(int argc, char* argv[]);
         void setupListeners();
-
-        //poll stuff
-        void handleTimeouts(long now_ms, long idle_ms);
-        void handleListenerEvent(size_t index, long now_ms);
-        bool handleClientRead(size_t &index, long now_ms, char* buf, size_t buf_size);
-        bool handleClientWrite(size_t &index, long now_ms);
-        void closeClient(size_t &index);
+        int  addListener(uint16_t port);
+
+        //reactor stuff
+        void handleTimeouts(long now_ms);
+        void touchClient(int fd, Client& c);
+        void handleListenerEvent(int lfd, long now_ms);
+        bool handleClientRead(int fd, long now_ms, char* buf, size_t buf_size);
+        bool handleClientWrite(int fd, long now_ms);
+        void processRequest(int fd, Client& c, long now_ms);
+        bool parseRequest(int fd, Client& c, long now_ms);
+        bool beginRequest(Client& c, size_t header_end);
+        void rejectRequest(Client& c, int code, const std::string& html);
+        void queueResponse(Client& c, Response& res);
+        void closeClient(int fd);
+
+        // CGI im Reactor
+        void startCgi(int fd, Client& c, const std::shared_ptr<CgiJob>& job);
+        void handleCgiEvent(int pipe_fd, long now_ms);
+        void completeCgi(int fd, Client& c, long now_ms);
+        bool streamCgi(int fd, Client& c, long now_ms);
+        void forwardCgiOutput(Client& c, bool last = false);
+        void endCgiStream(int fd, Client& c, long now_ms);
+        void resumeCgi(Client& c);
+        void finishCgi(int fd, Client& c, long now_ms);
+        void abortCgi(Client& c);
+        void dropCgiFd(int& pipe_fd);
+        void reapCgi(long now_ms);
+
+        // FastCGI-Backends
+        void      startFastCgi(int fd, Client& c, const std::shared_ptr<CgiJob>& job);
+        FcgiConn* fcgiConnFor(const CgiJob& job);
+        bool      flushFcgi(FcgiConn* conn);
+        void      handleFcgiEvent(int sock, unsigned events, long now_ms);
+        void      closeFcgiConn(FcgiConn* conn);
+
+        // vorgestartete Interpreter (cgi_pool)
+        void             startCgiPools(long now_ms);
+        CgiPool&         cgiPoolFor(const LocationConfig& loc);
+        void             startPooledCgi(int fd, Client& c, const std::shared_ptr<CgiJob>& job);
+        CgiPool::Worker* spawnPoolWorker(CgiPool& pool, long now_ms);
+        void             runPool(CgiPool& pool, long now_ms);
+        void             flushPoolWorker(CgiPool::Worker& w);
+        void             handlePoolEvent(int sock, unsigned events, long now_ms);
+        void             retirePoolWorker(CgiPool& pool, CgiPool::Worker* w, bool kill);
+        void             reapIdlePoolWorkers(long now_ms);
+        int              poolTimeout(long now_ms) const;
+
+        // per-worker state
+        int                                  worker_id;
+        bool                                 reuse_port;   // SO_REUSEPORT: eigener Listener pro Worker
+        std::unique_ptr<Reactor>             reactor;
+        std::unordered_set<int>              listener_fds;
+        ConnTable<Client>                    clients;
+        TimerQueue                           timers;
+        std::unordered_map<int /*port*/, VhostTable>         vhosts;
+        std::unordered_map<int /*lfd*/,  int /*port*/>      port_by_listener_fd;
+        std::unordered_map<int /*pipe fd*/, ConnHandle>     cgi_fds;
+        std::vector<ConnHandle>              cgi_waiting;  // stdout zu, Prozess noch nicht abgeholt
+        std::vector<ConnHandle>              cgi_heads;    // Header-Block da, Streamen beginnt nach kurzer Wartezeit
+        std::vector<pid_t>                   cgi_orphans;  // abgebrochen (SIGKILL), noch abzuholen
+        std::map<std::string /*addr*/, std::vector<std::unique_ptr<FcgiConn> > > fcgi_pool;
+        std::unordered_map<int /*sock*/, FcgiConn*>         fcgi_fds;
+        std::map<const LocationConfig*, std::unique_ptr<CgiPool> > cgi_pools;
+        std::unordered_map<int /*sock*/, CgiPool*>          pool_fds;
 };
 
 int webserv(int argc, char* argv[]);
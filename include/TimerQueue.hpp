@@ -0,0 +1,54 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerQueue.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:40:05 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 11:40:05 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef TIMERQUEUE_HPP
+# define TIMERQUEUE_HPP
+
+#include <queue>
+#include <vector>
+#include "ConnTable.hpp"
+
+struct TimerEntry
+{
+    long       deadline_ms;
+    ConnHandle conn;
+};
+
+struct TimerLater
+{
+    bool operator()(const TimerEntry& a, const TimerEntry& b) const
+    {
+        return a.deadline_ms > b.deadline_ms;
+    }
+};
+
+// Min-Heap ueber Verbindungs-Deadlines.
+// Lazy: eine Verbindung hat hoechstens einen "scharfen" Eintrag (Client::timer_ms).
+// Verschiebt sich die Deadline nach hinten, wird beim Ablaufen einfach neu eingereiht,
+// statt bei jedem read/write den Heap anzufassen.
+class TimerQueue
+{
+    public:
+        void push(long deadline_ms, const ConnHandle& h);
+        bool empty() const { return heap.empty(); }
+        const TimerEntry& top() const { return heap.top(); }
+        void pop() { heap.pop(); }
+        size_t size() const { return heap.size(); }
+
+        // ms bis zur naechsten Deadline fuer reactor->wait (-1 = keine)
+        int nextTimeout(long now_ms) const;
+
+    private:
+        std::priority_queue<TimerEntry, std::vector<TimerEntry>, TimerLater> heap;
+};
+
+#endif
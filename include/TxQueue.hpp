@@ -0,0 +1,80 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TxQueue.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 13:21:50 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 13:21:50 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef TXQUEUE_HPP
+# define TXQUEUE_HPP
+
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include "Response.hpp"
+
+// Ein Stueck Ausgabe: entweder Speicher (data bzw. geteilt: shared) oder ein Dateiabschnitt (file)
+struct TxSegment
+{
+    std::string              data;
+    std::shared_ptr<const std::string> shared;   // z.B. Body aus dem content_cache
+    size_t                   off = 0;        // davon schon gesendet
+    std::shared_ptr<FileRef> file;
+    off_t                    file_off  = 0;
+    size_t                   file_left = 0;
+    bool                     last = false;   // letztes Segment einer Antwort
+
+    const std::string& bytes() const { return shared ? *shared : data; }
+};
+
+// Ausgabe-Warteschlange pro Verbindung.
+// Speicher-Segmente gehen gesammelt per writev() raus, Dateisegmente per sendfile().
+// Gesendetes wird ueber Offsets abgehakt statt mit erase() vorne aus dem String
+// geschnitten (das war O(n) pro Teil-Write). Segmente liegen in einem vector, der
+// nach dem Leerlaufen von vorn beginnt; gesendete Puffer kommen ueber buffer()
+// wieder zurueck -> im Keep-Alive-Dauerbetrieb keine Allokation pro Antwort.
+class TxQueue
+{
+    public:
+        enum Result { TX_DONE, TX_AGAIN, TX_ERROR };
+
+        TxQueue() : head(0), pending(0), completed(0) {}
+
+        // leerer String mit der Kapazitaet eines schon gesendeten Segments
+        std::string buffer();
+        void pushData(std::string data);
+        void pushShared(const std::shared_ptr<const std::string>& data);
+        void pushFile(const std::shared_ptr<FileRef>& file, off_t off, size_t len);
+        // Antwortgrenze hinter dem zuletzt eingereihten Segment
+        void endResponse();
+        // seit dem letzten Aufruf komplett gesendete Antworten
+        size_t takeCompleted();
+
+        bool   empty() const { return head == segs.size(); }
+        size_t bytes() const { return pending; }   // noch offene Bytes
+        void   clear();
+
+        // schreibt bis alles raus ist (TX_DONE), der Socket voll ist (TX_AGAIN)
+        // oder ein Fehler auftritt; sent = in diesem Aufruf gesendete Bytes
+        Result flush(int fd, size_t& sent);
+
+    private:
+        ssize_t writeData(int fd);
+        ssize_t writeFile(int fd, TxSegment& seg);
+        TxSegment& append();
+        void       popFront();
+
+        std::vector<TxSegment>   segs;    // offen ab head
+        size_t                   head;
+        std::vector<std::string> spare;   // geleerte Puffer fuer buffer()
+        size_t pending;
+        size_t completed;
+};
+
+#endif
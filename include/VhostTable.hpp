@@ -0,0 +1,47 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VhostTable.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 22:58:06 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 22:58:06 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef VHOSTTABLE_HPP
+# define VHOSTTABLE_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ServerConfig;
+
+// server-Bloecke eines Ports nach Host-Header, Reihenfolge wie bei nginx:
+// exakter Name, laengster fuehrender Wildcard ("*.example.com"), laengster
+// hinterer Wildcard ("www.example.*"), sonst der Default-Server (erster Block
+// bzw. "listen ... default_server"). Alles Hash-Lookups: exakt einer, die
+// Wildcards einer pro Label des Hosts. ".example.com" = example.com + *.example.com
+class VhostTable
+{
+    public:
+        VhostTable() : default_idx(0), has_default(false), has_default_flag(false) {}
+
+        // in Config-Reihenfolge aufrufen; der erste Eintrag pro Name gewinnt
+        void add(size_t idx, const ServerConfig& sc);
+        size_t defaultServer() const { return default_idx; }
+        // host = roher Host-Header (Port, Gross-/Kleinschreibung, Punkt am Ende egal)
+        size_t find(const std::string& host) const;
+
+    private:
+        std::unordered_map<std::string, size_t> exact;
+        std::unordered_map<std::string, size_t> head_wild;   // ".example.com"
+        std::unordered_map<std::string, size_t> tail_wild;   // "www.example."
+        size_t default_idx;
+        bool   has_default;
+        bool   has_default_flag;   // default_idx kam von "default_server"
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include "LocationTrie.hpp"
 
 // webserv/
 // ├── src/                     ← Dein Code (main.cpp, config.cpp)
@@ -48,22 +49,41 @@ struct LocationConfig {
 	bool autoindex;                    // z.B. true (on) oder false (off)
 	std::vector<std::string> methods;  // z.B. {"GET", "POST", "DELETE"}
 	std::map<std::string, std::string> cgi;  // z.B. {".php", "/usr/bin/php-cgi"}
+	std::string fastcgi;               // z.B. "unix:/run/app.sock" oder "127.0.0.1:9000" (statt fork/exec)
+	bool fastcgi_mpx = false;          // "fastcgi <addr> multiplex": mehrere Requests pro Verbindung
+	size_t cgi_pool = 0;               // "cgi_pool <n> [max_requests] [idle]": vorgestartete Interpreter (0 = fork pro Request)
+	size_t cgi_pool_max_requests = 0;  // Worker nach so vielen Requests ersetzen (0 = nie)
+	size_t cgi_pool_idle_ms = 0;       // unbenutzte Worker nach so langer Zeit beenden (0 = nie)
+	bool gzip_static = false;          // "gzip_static on": file.gz statt file, wenn der Client gzip kann
+	bool brotli_static = false;        // "brotli_static on": dasselbe mit file.br (hat Vorrang)
+	bool gzip = false;                 // "gzip on": Antworten on the fly komprimieren (gzip/deflate)
+	std::vector<std::string> gzip_types = {"text/html"};  // gzip_types: welche Content-Types (text/html immer)
+	size_t gzip_min_length = 256;      // kleinere Bodies lohnen nicht
+	int gzip_comp_level = 1;           // 1 (schnell) .. 9 (klein)
 	std::map<int, std::string> error_pages;  // Erbt von Server/Global
 	std::string cgi_dir;        // z.B. "./cgi-bin"
 	std::string error_dir;      // z.B. "./errors"
 	std::string data_dir;       // z.B. "./data"
 	std::string data_store;     // z.B. "$(data_dir)/posts.json"
 	size_t client_max_body_size = 0;
+	std::vector<std::string> cgi_env;  // feste CGI-Variablen ("K=V"), einmal beim Laden gebaut
+	std::string fs_root;               // root, leer -> "." (buildRoutes)
+	size_t strip_len = 0;              // so viel vom URL-Pfad gehoert zur Location ("/" -> 0)
 };
 
 // Struktur für Server-Konfiguration
 struct ServerConfig {
 	std::string listen_host;  // z.B. "127.0.0.1"
 	int listen_port;         // z.B. 80
-	std::string server_name;  // z.B. "localhost"
+	std::string server_name;  // z.B. "localhost" (erster Name, fuer SERVER_NAME)
+	std::vector<std::string> server_names;  // alle, auch "*.example.com" / "www.example.*" / ".example.com"
+	bool default_server = false;  // "listen <port> default_server"
 	std::vector<LocationConfig> locations;
 	std::map<int, std::string> error_pages;  // Erbt von Global
 	size_t client_max_body_size = 0;  // 0 = inherit from global
+	size_t content_cache_size = 0;         // content_cache <budget> [max_file]: Bytes pro Worker (0 = aus)
+	size_t content_cache_max_file = 65536; // groessere Dateien gehen weiter per sendfile
+	LocationTrie routes;                   // location-Lookup, nach dem Parsen gebaut
 };
 
 
@@ -74,11 +94,26 @@ public:
 	std::map<int, std::string> default_error_pages;  // Globale Error-Pages
 	size_t default_client_max_body_size;            // Globale Body-Size
 	std::map<std::string, std::string> variables;   // z.B. {"data_dir", "/var/www/data"}
-	size_t keepalive_timeout_ms = 75000;
+	size_t keepalive_timeout_ms = 75000;            // Leerlauf zwischen Requests
+	size_t header_timeout_ms = 60000;               // client_header_timeout
+	size_t body_timeout_ms = 60000;                 // client_body_timeout
+	size_t send_timeout_ms = 60000;                 // send_timeout (pro Schreibfortschritt)
+	std::string event_backend = "epoll";             // "epoll" oder "poll"
+	size_t pipeline_depth = 8;                      // max. Antworten pro Verbindung in der TxQueue (Pipelining)
+	size_t worker_processes = 1;                    // >1 -> Master + N geforkte Worker (geteilte Listener)
+	size_t worker_threads = 1;                      // >1 -> ein Reactor pro Thread (SO_REUSEPORT)
+	std::vector<int> worker_cpus;                   // worker_cpu_affinity: CPU pro Worker (leer = kein Pinning)
+	bool worker_cpu_auto = false;                   // worker_cpu_affinity auto -> Worker i auf CPU i
+	size_t open_file_cache_max = 0;                 // open_file_cache: max. Eintraege pro Worker (0 = aus)
+	size_t open_file_cache_inactive_ms = 60000;     // so lange ungenutzte Eintraege fliegen raus
+	size_t open_file_cache_valid_ms = 60000;        // open_file_cache_valid: so lange ohne neues stat() vertrauen
+	bool open_file_cache_errors = false;            // open_file_cache_errors: auch "nicht gefunden" merken
 
 	Config();  // Konstruktor mit Default-Werten
 	void parse_c(const std::string& filename);  // Parsen der Config-Datei
 	const std::vector<ServerConfig>& getServers() const { return servers; }
+	// abgeleitete Daten (CGI-Env, Routing) bauen; parse_c ruft das selbst auf
+	void finalize();
 
 private:
     // Kleine Helferfunktionen (wie wir besprochen haben)
@@ -90,6 +125,8 @@ private:
                                 LocationConfig*& currentLocation,
                                 const std::string& locationLine);
     void resolveVariables();
+    void buildCgiEnv();
+    void buildRoutes();
 };
 
 // Global Config instance (for error pages etc.)
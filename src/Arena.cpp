@@ -0,0 +1,90 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Arena.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 02:14:09 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 02:14:09 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Arena.hpp"
+#include <cstdint>
+#include <new>
+#include <utility>
+
+static char* payload(void* block, size_t header)
+{
+    return static_cast<char*>(block) + header;
+}
+
+// Kopf auf max_align_t aufrunden, damit der Anfang jedes Blocks passt
+static const size_t HEADER = (sizeof(void*) + sizeof(size_t) + alignof(std::max_align_t) - 1)
+                             & ~(alignof(std::max_align_t) - 1);
+
+Arena::~Arena()
+{
+    release(NULL);
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+    std::swap(blocks, other.blocks);
+    std::swap(cur, other.cur);
+    std::swap(end, other.end);
+    return *this;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t align)
+{
+    uintptr_t p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    if (!cur || p + bytes > reinterpret_cast<uintptr_t>(end))
+    {
+        grow(bytes + align);
+        p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    }
+    cur = reinterpret_cast<char*>(p + bytes);
+    return reinterpret_cast<void*>(p);
+}
+
+// jeder neue Block mindestens doppelt so gross wie der letzte
+void Arena::grow(size_t need)
+{
+    size_t size = blocks ? blocks->size * 2 : FIRST_BLOCK;
+    while (size < need)
+        size *= 2;
+    Block* b = static_cast<Block*>(::operator new(HEADER + size));
+    b->next = blocks;
+    b->size = size;
+    blocks = b;
+    cur = payload(b, HEADER);
+    end = cur + size;
+}
+
+void Arena::release(Block* keep)
+{
+    Block* b = blocks;
+    while (b)
+    {
+        Block* next = b->next;
+        if (b != keep)
+            ::operator delete(b);
+        b = next;
+    }
+    blocks = keep;
+    if (keep)
+        keep->next = NULL;
+}
+
+// alles Vergebene ist ab hier ungueltig; der groesste Block bleibt fuer den
+// naechsten Request (sofern er nicht ueber KEEP_MAX gewachsen ist)
+void Arena::reset()
+{
+    Block* keep = (blocks && blocks->size <= KEEP_MAX) ? blocks : NULL;
+    if (blocks && (blocks->next || !keep))
+        release(keep);
+    cur = keep ? payload(keep, HEADER) : NULL;
+    end = keep ? cur + keep->size : NULL;
+}
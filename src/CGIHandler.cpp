@@ -13,59 +13,269 @@
 #include "../include/CGIHandler.hpp"
 #include <unistd.h>
 #include <sys/wait.h>
-#include <sys/time.h>
+#include <csignal>
+#include <algorithm>
+#include <cerrno>
+#include <cctype>
 #include <fcntl.h>
-#include <signal.h>
-#include <sstream>
+#include <climits>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <string.h>
+#include <strings.h>
 #include <vector>
 #include <memory>
-#include <algorithm>
-#include <poll.h>
 
-static long long get_time_ms(void)
+CGIHandler::CGIHandler() {}
+CGIHandler::~CGIHandler() {}
+
+CgiJob::~CgiJob()
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    if (in_fd >= 0)
+        close(in_fd);
+    if (out_fd >= 0)
+        close(out_fd);
 }
 
-CGIHandler::CGIHandler() {}
-CGIHandler::~CGIHandler() {}
+CgiJob::Io CgiJob::writeInput()
+{
+    while (in_off < input.size())
+    {
+        ssize_t n = write(in_fd, input.data() + in_off, input.size() - in_off);
+        if (n > 0)
+        {
+            in_off += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return IO_AGAIN;
+        // EPIPE: Script liest den Body nicht (ganz) -> kein Fehler, Rest verwerfen
+        break;
+    }
+    std::string().swap(input);
+    return IO_DONE;
+}
 
-Response CGIHandler::execute(const Request& req)
+CgiJob::Io CgiJob::readOutput(size_t max)
 {
-    Response res;
-    size_t timeout_ms = g_cfg.keepalive_timeout_ms;
+    char buffer[16384];
+    for (size_t got = 0; ; )
+    {
+        if (got >= max)
+            return IO_AGAIN;   // Rest bleibt in der Pipe
+        ssize_t n = read(out_fd, buffer, std::min(sizeof(buffer), max - got));
+        if (n > 0)
+        {
+            output.append(buffer, static_cast<size_t>(n));
+            got += static_cast<size_t>(n);
+            continue;
+        }
+        if (n == 0)
+            return IO_DONE;
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return IO_AGAIN;
+        std::cerr << "read from CGI failed" << std::endl;
+        error = CGI_INTERNAL_ERROR;
+        return IO_ERROR;
+    }
+}
 
-#ifdef DEBUG
-    std::cout << "Executing CGI script: " << req.path 
-              << " (timeout: " << timeout_ms << "ms)" << std::endl;
-#endif
-    
-    std::map<std::string, std::string> env = buildEnv(req, req.path);
-    CGIResult result = runCGI(req.path, env, req.body, timeout_ms);
-    
-    if (result.error == CGI_SUCCESS)
+bool CgiJob::reap()
+{
+    if (exited)
+        return true;
+    int st = 0;
+    pid_t r = waitpid(pid, &st, WNOHANG);
+    if (r == 0 || (r < 0 && errno == EINTR))
+        return false;
+    if (r == pid)
+        status = st;
+    else
     {
-        res.statusCode = 200;
-        res.reasonPhrase = "OK";
-        res.body = result.output;
-        res.headers["Content-Type"] = "text/html";
-        res.headers["Content-Length"] = std::to_string(res.body.size());
-        
-        if (result.exit_status != 0)
+        std::cerr << "waitpid failed" << std::endl;
+        error = CGI_INTERNAL_ERROR;
+    }
+    exited = true;
+    return true;
+}
+
+static const size_t CGI_MAX_HEAD = 16 * 1024;
+
+// "Name:" am Anfang der ersten Zeile -> die Ausgabe beginnt mit Headern
+static bool starts_with_header(const std::string& out, size_t eol)
+{
+    size_t colon = out.find(':');
+    if (colon == 0 || colon == std::string::npos || colon > eol)
+        return false;
+    for (size_t i = 0; i < colon; ++i)
+    {
+        unsigned char ch = static_cast<unsigned char>(out[i]);
+        if (!isalnum(ch) && ch != '-' && ch != '_')
+            return false;
+    }
+    return true;
+}
+
+CgiHead CGIHandler::parseHead(const std::string& out, Response& res, size_t& body_off, size_t& content_length)
+{
+    body_off = 0;
+    content_length = std::string::npos;
+
+    size_t eol = out.find('\n');
+    if (eol == std::string::npos)
+        return out.size() > CGI_MAX_HEAD ? CGI_HEAD_NONE : CGI_HEAD_MORE;
+    if (!starts_with_header(out, eol))
+        return CGI_HEAD_NONE;
+
+    size_t end = out.find("\r\n\r\n");
+    size_t skip = 4;
+    size_t lf = out.find("\n\n");
+    if (lf != std::string::npos && (end == std::string::npos || lf < end))
+    {
+        end = lf;
+        skip = 2;
+    }
+    if (end == std::string::npos)
+        return out.size() > CGI_MAX_HEAD ? CGI_HEAD_NONE : CGI_HEAD_MORE;
+
+    std::istringstream block(out.substr(0, end));
+    std::string line;
+    bool have_status = false;
+    while (std::getline(block, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        std::string name = line.substr(0, colon);
+        size_t v = line.find_first_not_of(" \t", colon + 1);
+        std::string value = (v == std::string::npos) ? "" : line.substr(v);
+        HeaderId id = headerId(name);   // Gross/Klein egal
+
+        if (strcasecmp(name.c_str(), "Status") == 0)
         {
-            res.statusCode = 500;
-            res.reasonPhrase = "Internal Server Error";
+            res.statusCode = std::atoi(value.c_str());
+            size_t sp = value.find(' ');
+            res.reasonPhrase = (sp == std::string::npos) ? "" : value.substr(sp + 1);
+            have_status = true;
+        }
+        else if (id == H_CONTENT_TYPE)
+            res.headers.set(H_CONTENT_TYPE, value);
+        else if (id == H_CONTENT_LENGTH)
+        {
+            char* endp = NULL;
+            unsigned long long n = std::strtoull(value.c_str(), &endp, 10);
+            if (!value.empty() && isdigit(static_cast<unsigned char>(value[0])) && *endp == '\0')
+                content_length = static_cast<size_t>(n);
+        }
+        else if (id == H_CONNECTION || id == H_KEEP_ALIVE || id == H_TRANSFER_ENCODING)
+            continue;   // Framing bestimmen wir
+        else
+        {
+            if (id == H_LOCATION && !have_status)
+            {
+                res.statusCode = 302;
+                res.reasonPhrase = "Found";
+            }
+            res.headers.set(name, value);
+        }
+    }
+    body_off = end + skip;
+    return CGI_HEAD_DONE;
+}
+
+Response CGIHandler::finish(CgiJob& job)
+{
+    if (job.error != CGI_SUCCESS)
+        return createErrorResponse(job.error);
+    if (!job.fastcgi.empty())
+    {
+        if (job.status != 0)
+        {
+            std::cerr << "FastCGI app exited with status " << job.status << std::endl;
+            return createErrorResponse(CGI_SCRIPT_ERROR, job.status);
         }
     }
+    else if (WIFSIGNALED(job.status))
+    {
+        std::cerr << "CGI killed by signal " << WTERMSIG(job.status) << std::endl;
+        return createErrorResponse(CGI_SCRIPT_ERROR, 128 + WTERMSIG(job.status));
+    }
+    else if (WIFEXITED(job.status) && WEXITSTATUS(job.status) != 0)
+    {
+        std::cerr << "CGI exited with code " << WEXITSTATUS(job.status) << std::endl;
+        return createErrorResponse(CGI_SCRIPT_ERROR, WEXITSTATUS(job.status));
+    }
+
+    Response res;
+    res.statusCode = 200;
+    res.reasonPhrase = "OK";
+    res.headers.set(H_CONTENT_TYPE, "text/html");
+    size_t body_off;
+    size_t content_length;
+    if (parseHead(job.output, res, body_off, content_length) == CGI_HEAD_DONE)
+        job.output.erase(0, body_off);   // Content-Length rechnen wir selbst
+    res.body.swap(job.output);
+    res.headers.set(H_SERVER, "webserv/1.0");
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+    res.headers.set(H_CONNECTION, "close");
+    res.headers.set(H_KEEP_ALIVE, "timeout=0, max=0");
+    res.keep_alive = false;
+    return res;
+}
+
+Response CGIHandler::beginStream(CgiJob& job)
+{
+    Response res;
+    res.statusCode = 200;
+    res.reasonPhrase = "OK";
+    res.headers.set(H_CONTENT_TYPE, "text/html");
+    size_t body_off;
+    size_t content_length;
+    if (parseHead(job.output, res, body_off, content_length) == CGI_HEAD_DONE)
+        job.output.erase(0, body_off);
     else
+        content_length = std::string::npos;
+
+    // gzip: Laenge ist vorher unbekannt, also immer chunked bzw. bis Verbindungsende
+    bool deflate = false;
+    if (job.gzip && gzipApplies(*job.gzip, res))
     {
-        res = createErrorResponse(result.error, result.exit_status);
+        addVary(res, "Accept-Encoding");
+        if (!job.encoding.empty())
+        {
+            job.deflater.reset(new Deflater());
+            deflate = job.deflater->init(job.encoding, job.gzip->gzip_comp_level);
+            if (deflate)
+                res.headers.set(H_CONTENT_ENCODING, job.encoding);
+            else
+                job.deflater.reset();
+        }
     }
-    
+
+    // Laenge vom Script -> identity, sonst chunked; HTTP/1.0 bis Verbindungsende
+    job.stream_left = content_length;
+    job.chunked = false;
+    if (content_length != std::string::npos && !deflate)
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(content_length));
+    else if (job.http11)
+    {
+        res.headers.set(H_TRANSFER_ENCODING, "chunked");
+        job.chunked = true;
+    }
+    else
+        job.keep_alive = false;
+    res.headers.set(H_SERVER, "webserv/1.0");
+    res.headers.set(H_CONNECTION, job.keep_alive ? "keep-alive" : "close");
+    res.headers.set(H_KEEP_ALIVE, job.keep_alive ? "timeout=5, max=100" : "timeout=0, max=0");
+    res.keep_alive = job.keep_alive;
+    job.streaming = true;
     return res;
 }
 
@@ -93,6 +303,12 @@ Response CGIHandler::createErrorResponse(CGI_Error error, int script_exit_status
             res.reasonPhrase = "Bad Gateway";
             res.body = "<h1>502 Bad Gateway</h1><p>Failed to execute CGI script</p>";
             break;
+
+        case CGI_UPSTREAM_ERROR:
+            res.statusCode = 502;
+            res.reasonPhrase = "Bad Gateway";
+            res.body = "<h1>502 Bad Gateway</h1><p>FastCGI backend not available</p>";
+            break;
             
         case CGI_FORK_ERROR:
         case CGI_PIPE_ERROR:
@@ -109,30 +325,59 @@ Response CGIHandler::createErrorResponse(CGI_Error error, int script_exit_status
             break;
     }
     
-    res.headers["Content-Type"] = "text/html";
-    res.headers["Content-Length"] = std::to_string(res.body.size());
-    res.headers["Connection"] = "close";
+    res.headers.set(H_CONTENT_TYPE, "text/html");
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+    res.headers.set(H_CONNECTION, "close");
     res.keep_alive = false;
     
     return res;
 }
 
-std::map<std::string, std::string> CGIHandler::buildEnv(const Request& req, const std::string& scriptPath)
+// Variablen, die sich pro Request aendern; der Rest steht in config.cgi_env
+static std::vector<std::string> request_env(const Request& req, const std::string& scriptPath)
+{
+    std::vector<std::string> env;
+    env.reserve(6);
+    env.push_back("REQUEST_METHOD=" + req.method);
+    env.push_back("SCRIPT_FILENAME=" + scriptPath);
+    env.push_back("SCRIPT_NAME=" + req.path);
+    env.push_back("QUERY_STRING=" + req.query);
+    env.push_back("CONTENT_LENGTH=" + std::to_string(req.body.size()));
+    env.push_back("CONTENT_TYPE=text/plain");
+    return env;
+}
+
+static void add_env_entries(std::map<std::string, std::string>& env, const std::vector<std::string>& entries)
+{
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        size_t eq = entries[i].find('=');
+        env[entries[i].substr(0, eq)] = entries[i].substr(eq + 1);
+    }
+}
+
+// als Map fuer FastCGI-Params und den cgi_pool
+std::map<std::string, std::string> CGIHandler::buildEnv(const Request& req, const LocationConfig& config, const std::string& scriptPath)
 {
     std::map<std::string, std::string> env;
-    env["GATEWAY_INTERFACE"] = "CGI/1.1";
-    env["REQUEST_METHOD"] = req.method;
-    env["SCRIPT_FILENAME"] = scriptPath;
-    env["SCRIPT_NAME"] = req.path;
-    env["QUERY_STRING"] = req.query;
-    env["CONTENT_LENGTH"] = std::to_string(req.body.size());
-    env["CONTENT_TYPE"] = "text/plain";
-    env["SERVER_PROTOCOL"] = "HTTP/1.1";
-    env["SERVER_SOFTWARE"] = "webserv/1.0";
-    env["REDIRECT_STATUS"] = "200";
+    add_env_entries(env, config.cgi_env);
+    add_env_entries(env, request_env(req, scriptPath));
     return env;
 }
 
+void init_spawn_attr(posix_spawnattr_t& attr)
+{
+    sigset_t none;
+    sigset_t def;
+    sigemptyset(&none);
+    sigemptyset(&def);
+    sigaddset(&def, SIGPIPE);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setsigdefault(&attr, &def);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+}
+
 static std::string getInterpreter(const std::string& scriptPath)
 {
     if (scriptPath.find(".py") != std::string::npos)
@@ -142,7 +387,7 @@ static std::string getInterpreter(const std::string& scriptPath)
     return "";
 }
 
-static bool chdir_to_script_dir(const std::string& scriptPath, std::string& outDir, std::string& outName)
+static void split_script_path(const std::string& scriptPath, std::string& outDir, std::string& outName)
 {
     size_t lastSlash = scriptPath.find_last_of('/');
     if (lastSlash != std::string::npos) {
@@ -152,377 +397,122 @@ static bool chdir_to_script_dir(const std::string& scriptPath, std::string& outD
         outDir = ".";
         outName = scriptPath;
     }
-    if (chdir(outDir.c_str()) != 0) {
-        perror("chdir to script directory");
-        return false;
-    }
-    return true;
 }
 
-static std::vector<char*> build_envp_vec(const std::map<std::string, std::string>& env)
+static void close_pipe(int p[2])
 {
-    std::vector<char*> envp_vec;
-    envp_vec.reserve(env.size() + 1);
-    for (std::map<std::string, std::string>::const_iterator it = env.begin(); it != env.end(); ++it)
-    {
-        std::string entry = it->first + "=" + it->second;
-        envp_vec.push_back(strdup(entry.c_str()));
-    }
-    envp_vec.push_back(NULL);
-    return envp_vec;
-}
-
-static void free_envp_vec(std::vector<char*>& envp_vec)
-{
-    for (size_t j = 0; j + 1 < envp_vec.size(); ++j) {
-        if (envp_vec[j]) free(envp_vec[j]);
-    }
-}
-
-static bool write_with_timeout(int fd, const std::string& data, size_t timeout_ms, long long start_time)
-{
-    if (data.empty())
-        return true;
-
-    size_t written = 0;
-    const char* buf = data.c_str();
-    size_t total = data.size();
-
-    while (written < total)
-    {
-        if (get_time_ms() - start_time > static_cast<long long>(timeout_ms))
-            return false;
-
-        ssize_t n = write(fd, buf + written, total - written);
-        
-        if (n > 0)
-        {
-            written += static_cast<size_t>(n);
-        }
-        else if (n < 0)
-        {
-            usleep(1000);
-            continue;
-        }
-        else
-        {
-            return false;
-        }
-    }
-    return true;
+    if (p[0] >= 0) close(p[0]);
+    if (p[1] >= 0) close(p[1]);
 }
 
-static bool read_with_poll_timeout(int fd, std::string& output, pid_t pid, size_t timeout_ms, int& exit_status, CGI_Error& cgi_error)
+// posix_spawn (vfork-artig: kopiert weder Heap noch Seitentabellen, kostet
+// also gleich viel, egal wie gross der Server ist) ohne auf das Script zu
+// warten. dup2 und chdir laufen als File-Actions im Kind. Alle Pipe-Enden
+// sind CLOEXEC, damit parallel gestartete Scripts keine fremden Enden erben
+// (sonst kaeme das EOF auf stdout erst, wenn auch das andere fertig ist).
+bool CGIHandler::start(const Request& req, const LocationConfig& config, const std::string& execPath,
+                       const std::string& scriptFile, Response& res)
 {
-    long long read_start = get_time_ms();
-    bool process_done = false;
-    char buffer[4096];
-    exit_status = 0;
-    cgi_error = CGI_SUCCESS;
-
-    while (!process_done)
-    {
-        long long elapsed = get_time_ms() - read_start;
-        if (elapsed > static_cast<long long>(timeout_ms))
-        {
-            cgi_error = CGI_TIMEOUT;
-            return false;
-        }
-
-        int status;
-        pid_t ret = waitpid(pid, &status, WNOHANG);
-        
-        if (ret == pid)
-        {
-            process_done = true;
-            
-            ssize_t bytes;
-            while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
-            {
-                output.append(buffer, static_cast<size_t>(bytes));
-            }
-            
-            if (WIFEXITED(status))
-            {
-                exit_status = WEXITSTATUS(status);
-                if (exit_status != 0)
-                {
-                    cgi_error = CGI_SCRIPT_ERROR;
-                    std::cerr << "CGI exited with code " << exit_status << std::endl;
-                }
-            }
-            else if (WIFSIGNALED(status))
-            {
-                cgi_error = CGI_SCRIPT_ERROR;
-                exit_status = 128 + WTERMSIG(status);
-                std::cerr << "CGI killed by signal " << WTERMSIG(status) << std::endl;
-            }
-            break;
-        }
-        else if (ret < 0)
-        {
-            cgi_error = CGI_INTERNAL_ERROR;
-            std::cerr << "waitpid failed" << std::endl;
-            return false;
-        }
-
-        pollfd pfd;
-        pfd.fd = fd;
-        pfd.events = POLLIN;
-        pfd.revents = 0;
-
-        int remaining_ms = static_cast<int>(timeout_ms - elapsed);
-        if (remaining_ms < 0) remaining_ms = 0;
-
-        int poll_ret = poll(&pfd, 1, std::min(remaining_ms, 100));
-
-        if (poll_ret > 0 && (pfd.revents & POLLIN))
-        {
-            ssize_t bytes = read(fd, buffer, sizeof(buffer));
-            if (bytes > 0)
-            {
-                output.append(buffer, static_cast<size_t>(bytes));
-                read_start = get_time_ms();
-            }
-            else if (bytes == 0)
-            {
-                continue;
-            }
-            else if (bytes < 0)
-            {
-                cgi_error = CGI_INTERNAL_ERROR;
-                std::cerr << "read from CGI failed" << std::endl;
-                return false;
-            }
-        }
-        else if (poll_ret < 0)
-        {
-            cgi_error = CGI_INTERNAL_ERROR;
-            std::cerr << "poll failed" << std::endl;
-            return false;
-        }
-    }
-
-    return true;
-}
+    std::cout << "Executing CGI: " << (execPath.empty() ? scriptFile : execPath)
+              << " (script file: " << scriptFile << ")"
+              << " (timeout: " << g_cfg.keepalive_timeout_ms << "ms)" << std::endl;
 
-CGIResult CGIHandler::runCGI(const std::string& scriptPath, const std::map<std::string, std::string>& env, 
-                             const std::string& body, size_t timeout_ms)
-{
-    CGIResult result;
-    
-    int pipeIn[2];
-    int pipeOut[2];
+    int pipeIn[2] = {-1, -1};
+    int pipeOut[2] = {-1, -1};
 
-    if (pipe(pipeIn) < 0 || pipe(pipeOut) < 0)
+    if (pipe2(pipeIn, O_CLOEXEC) < 0 || pipe2(pipeOut, O_CLOEXEC) < 0)
     {
         perror("pipe");
-        result.error = CGI_PIPE_ERROR;
-        return result;
+        close_pipe(pipeIn);
+        close_pipe(pipeOut);
+        res = createErrorResponse(CGI_PIPE_ERROR);
+        return false;
     }
 
-    fcntl(pipeOut[0], F_SETFL, O_NONBLOCK);
-    fcntl(pipeIn[1], F_SETFL, O_NONBLOCK);
+    std::string scriptDir;
+    std::string scriptName;
+    split_script_path(scriptFile, scriptDir, scriptName);
 
-    pid_t pid = fork();
-
-    if (pid == 0)
+    std::string program = execPath.empty() ? getInterpreter(scriptFile) : execPath;
+    std::vector<char*> argv;
+    if (program.empty())
+        program = scriptName;      // ausfuehrbares Script direkt (relativ zu scriptDir)
+    else
+        argv.push_back(const_cast<char*>(program.c_str()));
+    argv.push_back(const_cast<char*>(scriptName.c_str()));
+    argv.push_back(NULL);
+
+    // envp: Zeiger auf die Vorlage der Location + die Request-Variablen
+    std::vector<std::string> per_request = request_env(req, scriptFile);
+    std::vector<char*> envp;
+    envp.reserve(config.cgi_env.size() + per_request.size() + 1);
+    for (size_t i = 0; i < config.cgi_env.size(); ++i)
+        envp.push_back(const_cast<char*>(config.cgi_env[i].c_str()));
+    for (size_t i = 0; i < per_request.size(); ++i)
+        envp.push_back(const_cast<char*>(per_request[i].c_str()));
+    envp.push_back(NULL);
+
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, pipeIn[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, pipeOut[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addchdir_np(&fa, scriptDir.c_str());
+    init_spawn_attr(attr);
+
+    pid_t pid = -1;
+    int err = posix_spawn(&pid, program.c_str(), &fa, &attr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+
+    close(pipeIn[0]);
+    close(pipeOut[1]);
+    if (err != 0)
     {
-        // CHILD PROCESS
-        dup2(pipeIn[0], STDIN_FILENO);
-        dup2(pipeOut[1], STDOUT_FILENO);
+        // chdir/execve-Fehler meldet posix_spawn direkt (statt Exit 127 im Kind)
+        std::cerr << "posix_spawn " << program << ": " << strerror(err) << std::endl;
         close(pipeIn[1]);
         close(pipeOut[0]);
-
-        std::string scriptDir;
-        std::string scriptName;
-        if (!chdir_to_script_dir(scriptPath, scriptDir, scriptName))
-            exit(1);
-
-        std::vector<char*> envp_vec = build_envp_vec(env);
-
-        std::string interpreter = getInterpreter(scriptPath);
-        std::vector<char*> argv;
-        argv.reserve(3);
-
-        if (!interpreter.empty()) {
-            argv.push_back(const_cast<char*>(interpreter.c_str()));
-            argv.push_back(const_cast<char*>(scriptName.c_str()));
-            argv.push_back(NULL);
-            execve(interpreter.c_str(), argv.data(), envp_vec.data());
-        } 
-        else
-        {
-            argv.push_back(const_cast<char*>(scriptName.c_str()));
-            argv.push_back(NULL);
-            execve(scriptName.c_str(), argv.data(), envp_vec.data());
-        }
-
-        free_envp_vec(envp_vec);
-        perror("execve");
-        exit(127);
+        res = createErrorResponse((err == EAGAIN || err == ENOMEM) ? CGI_FORK_ERROR : CGI_EXEC_ERROR);
+        return false;
     }
-    else if (pid > 0)
-    {
-        // PARENT PROCESS
-        close(pipeIn[0]);
-        close(pipeOut[1]);
-
-        long long start_time = get_time_ms();
-
-        bool write_ok = write_with_timeout(pipeIn[1], body, timeout_ms, start_time);
-        close(pipeIn[1]);
-
-        if (!write_ok)
-        {
-            kill(pid, SIGKILL);
-            close(pipeOut[0]);
-            waitpid(pid, NULL, 0);
-            result.error = CGI_TIMEOUT;
-            return result;
-        }
 
-        bool read_ok = read_with_poll_timeout(pipeOut[0], result.output, pid, timeout_ms, 
-                                              result.exit_status, result.error);
-        
-        close(pipeOut[0]);
-
-        if (!read_ok && result.error == CGI_TIMEOUT)
-        {
-            kill(pid, SIGKILL);
-            waitpid(pid, NULL, 0);
-            std::cerr << "CGI script timed out after " << timeout_ms << "ms" << std::endl;
-        }
-        else if (!read_ok)
-        {
-            kill(pid, SIGKILL);
-            waitpid(pid, NULL, 0);
-        }
+    fcntl(pipeIn[1], F_SETFL, O_NONBLOCK);
+    fcntl(pipeOut[0], F_SETFL, O_NONBLOCK);
 
-        return result;
-    }
-    else
-    {
-        perror("fork");
-        result.error = CGI_FORK_ERROR;
-        return result;
-    }
+    std::shared_ptr<CgiJob> job = std::make_shared<CgiJob>();
+    job->pid = pid;
+    job->in_fd = pipeIn[1];
+    job->out_fd = pipeOut[0];
+    res.cgi = job;
+    return true;
 }
 
-Response CGIHandler::executeWith(const Request& req, const std::string& execPath, const std::string& scriptFile)
+// Backend bzw. Pool-Worker laufen mit eigenem cwd -> absoluter Pfad
+static std::string absolute_script(const std::string& scriptFile)
 {
-    Response res;
-    size_t timeout_ms = g_cfg.keepalive_timeout_ms;
-
-    std::cout << "Executing CGI executable: " << execPath
-              << " (script file: " << scriptFile << ")"
-              << " (timeout: " << timeout_ms << "ms)" << std::endl;
-
-    std::map<std::string, std::string> env = buildEnv(req, scriptFile);
-
-    int pipeIn[2];
-    int pipeOut[2];
-
-    if (pipe(pipeIn) < 0 || pipe(pipeOut) < 0)
-    {
-        perror("pipe");
-        return createErrorResponse(CGI_PIPE_ERROR);
-    }
-
-    fcntl(pipeOut[0], F_SETFL, O_NONBLOCK);
-    fcntl(pipeIn[1], F_SETFL, O_NONBLOCK);
-
-    pid_t pid = fork();
-    if (pid == 0)
-    {
-        // CHILD
-        dup2(pipeIn[0], STDIN_FILENO);
-        dup2(pipeOut[1], STDOUT_FILENO);
-        close(pipeIn[1]);
-        close(pipeOut[0]);
-
-        std::string scriptDir;
-        std::string scriptName;
-        if (!chdir_to_script_dir(scriptFile, scriptDir, scriptName))
-            exit(1);
-
-        std::vector<char*> envp_vec = build_envp_vec(env);
-
-        std::vector<char*> argv;
-        argv.reserve(3);
-        argv.push_back(const_cast<char*>(execPath.c_str()));
-        if (!scriptName.empty())
-            argv.push_back(const_cast<char*>(scriptName.c_str()));
-        argv.push_back(NULL);
-
-        execve(execPath.c_str(), argv.data(), envp_vec.data());
-
-        free_envp_vec(envp_vec);
-        perror("execve");
-        exit(127);
-    }
-    else if (pid > 0)
-    {
-        // PARENT PROCESS
-        close(pipeIn[0]);
-        close(pipeOut[1]);
-
-        long long start_time = get_time_ms();
-
-        bool write_ok = write_with_timeout(pipeIn[1], req.body, timeout_ms, start_time);
-        close(pipeIn[1]);
-
-        if (!write_ok)
-        {
-            kill(pid, SIGKILL);
-            close(pipeOut[0]);
-            waitpid(pid, NULL, 0);
-            return createErrorResponse(CGI_TIMEOUT);
-        }
+    char resolved[PATH_MAX];
+    if (realpath(scriptFile.c_str(), resolved))
+        return resolved;
+    return scriptFile;
+}
 
-        CGIResult result;
-        bool read_ok = read_with_poll_timeout(pipeOut[0], result.output, pid, timeout_ms, 
-                                              result.exit_status, result.error);
-        
-        close(pipeOut[0]);
-        
-        if (!read_ok)
-        {
-            kill(pid, SIGKILL);
-            waitpid(pid, NULL, 0);
-            
-            if (result.error == CGI_TIMEOUT)
-            {
-                std::cerr << "CGI script timed out after " << timeout_ms << "ms" << std::endl;
-            }
-            
-            return createErrorResponse(result.error, result.exit_status);
-        }
+void CGIHandler::startFastCgi(const Request& req, const LocationConfig& config, const std::string& scriptFile, Response& res)
+{
+    std::string script = absolute_script(scriptFile);
+
+    std::shared_ptr<CgiJob> job = std::make_shared<CgiJob>();
+    job->fastcgi = config.fastcgi;
+    job->fastcgi_mpx = config.fastcgi_mpx;
+    job->params = buildEnv(req, config, script);
+    job->params["REQUEST_URI"] = req.path;
+    res.cgi = job;
+}
 
-        if (result.error == CGI_SUCCESS)
-        {
-            res.statusCode = 200;
-            res.reasonPhrase = "OK";
-            res.headers["Content-Type"] = "text/html";
-            res.body = result.output;
-            res.headers["Content-Length"] = std::to_string(res.body.size());
-            
-            if (result.exit_status != 0)
-            {
-                res.statusCode = 500;
-                res.reasonPhrase = "Internal Server Error";
-            }
-        }
-        else
-        {
-            res = createErrorResponse(result.error, result.exit_status);
-        }
-        
-        return res;
-    }
-    else
-    {
-        perror("fork");
-        return createErrorResponse(CGI_FORK_ERROR);
-    }
-}
\ No newline at end of file
+void CGIHandler::startPooled(const Request& req, const LocationConfig& config, const std::string& scriptFile, Response& res)
+{
+    std::shared_ptr<CgiJob> job = std::make_shared<CgiJob>();
+    job->pool = &config;
+    job->params = buildEnv(req, config, absolute_script(scriptFile));
+    res.cgi = job;
+}
@@ -0,0 +1,301 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CgiPool.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 16:40:12 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 16:40:12 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "CgiPool.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Laeuft in jedem Worker (python3 -c): Request lesen, Umgebung/stdin/stdout
+// umbiegen, Script per runpy ausfuehren, Ausgabe + Exit-Code zurueck.
+// Exceptions und sys.exit() beenden nur den Request, nicht den Worker.
+static const char* POOL_BOOTSTRAP = R"PY(
+import io, os, runpy, socket, struct, sys, traceback
+ch = socket.socket(fileno=3)
+def recv(n):
+    b = bytearray()
+    while len(b) < n:
+        d = ch.recv(n - len(b))
+        if not d:
+            os._exit(0)
+        b += d
+    return bytes(b)
+class Out(io.BytesIO):
+    def close(self):
+        pass
+base = dict(os.environb)
+path0 = list(sys.path)
+while True:
+    elen, blen = struct.unpack('>II', recv(8))
+    env = recv(elen)
+    body = recv(blen)
+    os.environb.clear()
+    os.environb.update(base)
+    for kv in env.split(b'\0'):
+        k, _, v = kv.partition(b'=')
+        if k:
+            os.environb[k] = v
+    script = os.environ.get('SCRIPT_FILENAME', '')
+    d = os.path.dirname(script)
+    out = Out()
+    sys.stdin = io.TextIOWrapper(io.BytesIO(body), encoding='utf-8')
+    sys.stdout = io.TextIOWrapper(out, encoding='utf-8', write_through=True)
+    sys.argv = [script]
+    sys.path[:] = [d] + path0
+    code = 0
+    try:
+        if d and d != os.getcwd():
+            os.chdir(d)
+        runpy.run_path(script, run_name='__main__')
+    except SystemExit as e:
+        if e.code is None or isinstance(e.code, int):
+            code = e.code or 0
+        else:
+            print(e.code, file=sys.stderr)
+            code = 1
+    except BaseException:
+        traceback.print_exc()
+        code = 1
+    try:
+        sys.stdout.flush()
+    except Exception:
+        pass
+    sys.stdin, sys.stdout = sys.__stdin__, sys.__stdout__
+    data = out.getvalue()
+    ch.sendall(struct.pack('>iI', code & 0xff, len(data)) + data)
+)PY";
+
+static void put_u32(std::string& out, uint32_t v)
+{
+    out += static_cast<char>((v >> 24) & 0xff);
+    out += static_cast<char>((v >> 16) & 0xff);
+    out += static_cast<char>((v >> 8) & 0xff);
+    out += static_cast<char>(v & 0xff);
+}
+
+static uint32_t get_u32(const std::string& in, size_t off)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(in.data() + off);
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+         | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static std::string pool_interpreter(const LocationConfig& loc)
+{
+    std::map<std::string, std::string>::const_iterator it = loc.cgi.find(".py");
+    return it != loc.cgi.end() ? it->second : "/usr/bin/python3";
+}
+
+CgiPool::CgiPool(const LocationConfig& loc)
+    : loc(loc), interpreter(pool_interpreter(loc)), root(loc.root.empty() ? "." : loc.root)
+{}
+
+// Sockets zu -> Worker bekommen EOF und beenden sich
+CgiPool::~CgiPool()
+{
+    for (size_t i = 0; i < workers.size(); ++i)
+        ::close(workers[i]->sock);
+}
+
+bool CgiPool::handles(const LocationConfig& loc, const std::string& scriptFile)
+{
+    if (loc.cgi_pool == 0)
+        return false;
+    if (scriptFile.size() < 3 || scriptFile.compare(scriptFile.size() - 3, 3, ".py") != 0)
+        return false;
+    std::string interp = pool_interpreter(loc);
+    return interp.find("python", interp.find_last_of('/') + 1) != std::string::npos;
+}
+
+CgiPool::Worker* CgiPool::spawn(long now_ms)
+{
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+    {
+        perror("socketpair");
+        return NULL;
+    }
+
+    if (sv[1] == 3)
+    {
+        // adddup2 auf sich selbst wuerde CLOEXEC nicht loeschen
+        int moved = fcntl(sv[1], F_DUPFD_CLOEXEC, 4);
+        ::close(sv[1]);
+        sv[1] = moved;
+    }
+
+    // wie bei CGIHandler::start per posix_spawn, Socket als fd 3
+    char* argv[] = { const_cast<char*>(interpreter.c_str()), const_cast<char*>("-c"),
+                     const_cast<char*>(POOL_BOOTSTRAP), NULL };
+    char* envp[] = { NULL };
+
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&fa, sv[1], 3);
+    posix_spawn_file_actions_addchdir_np(&fa, root.c_str());
+    init_spawn_attr(attr);
+
+    pid_t pid = -1;
+    int err = sv[1] < 0 ? errno : posix_spawn(&pid, argv[0], &fa, &attr, argv, envp);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (sv[1] >= 0)
+        ::close(sv[1]);
+    if (err != 0)
+    {
+        std::cerr << "cgi_pool: cannot start " << interpreter << ": " << strerror(err) << std::endl;
+        ::close(sv[0]);
+        return NULL;
+    }
+    fcntl(sv[0], F_SETFL, O_NONBLOCK);
+
+    std::unique_ptr<Worker> w(new Worker);
+    w->pid = pid;
+    w->sock = sv[0];
+    w->idle_since = now_ms;
+    workers.push_back(std::move(w));
+    return workers.back().get();
+}
+
+CgiPool::Worker* CgiPool::idle()
+{
+    for (size_t i = 0; i < workers.size(); ++i)
+        if (!workers[i]->job && !workers[i]->eof)
+            return workers[i].get();
+    return NULL;
+}
+
+CgiPool::Worker* CgiPool::find(int sock)
+{
+    for (size_t i = 0; i < workers.size(); ++i)
+        if (workers[i]->sock == sock)
+            return workers[i].get();
+    return NULL;
+}
+
+CgiPool::Worker* CgiPool::find(const CgiJob* job)
+{
+    for (size_t i = 0; i < workers.size(); ++i)
+        if (workers[i]->job.get() == job)
+            return workers[i].get();
+    return NULL;
+}
+
+void CgiPool::assign(Worker& w, const Pending& p)
+{
+    CgiJob& job = *p.job;
+    std::string env;
+    for (std::map<std::string, std::string>::const_iterator it = job.params.begin(); it != job.params.end(); ++it)
+    {
+        env += it->first;
+        env += '=';
+        env += it->second;
+        env += '\0';
+    }
+
+    w.job = p.job;
+    w.client = p.client;
+    w.wbuf.clear();
+    w.woff = 0;
+    w.rbuf.clear();
+    put_u32(w.wbuf, static_cast<uint32_t>(env.size()));
+    put_u32(w.wbuf, static_cast<uint32_t>(job.input.size()));
+    w.wbuf += env;
+    w.wbuf += job.input;
+    std::string().swap(job.input);
+}
+
+CgiJob::Io CgiPool::onWritable(Worker& w)
+{
+    while (w.woff < w.wbuf.size())
+    {
+        ssize_t n = ::send(w.sock, w.wbuf.data() + w.woff, w.wbuf.size() - w.woff, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            w.woff += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return CgiJob::IO_AGAIN;
+        return CgiJob::IO_ERROR;
+    }
+    std::string().swap(w.wbuf);
+    w.woff = 0;
+    return CgiJob::IO_DONE;
+}
+
+CgiJob::Io CgiPool::onReadable(Worker& w)
+{
+    char buf[16384];
+    while (!w.eof)
+    {
+        ssize_t n = ::recv(w.sock, buf, sizeof(buf), 0);
+        if (n > 0)
+        {
+            w.rbuf.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        w.eof = true;   // Worker ist weg; eine schon komplette Antwort zaehlt noch
+    }
+
+    if (!w.job || w.rbuf.size() < 8 || w.rbuf.size() < 8 + static_cast<size_t>(get_u32(w.rbuf, 4)))
+        return (w.eof || (!w.job && !w.rbuf.empty())) ? CgiJob::IO_ERROR : CgiJob::IO_AGAIN;
+
+    size_t len = get_u32(w.rbuf, 4);
+    if (w.rbuf.size() != 8 + len)
+        return CgiJob::IO_ERROR;   // Worker schreibt ungefragt -> Protokollfehler
+    w.job->status = static_cast<int>(get_u32(w.rbuf, 0) & 0xff) << 8;   // wie waitpid: WEXITSTATUS
+    w.job->output.assign(w.rbuf, 8, len);
+    w.job->exited = true;
+    std::string().swap(w.rbuf);
+    return CgiJob::IO_DONE;
+}
+
+void CgiPool::release(Worker& w, long now_ms)
+{
+    w.job.reset();
+    w.client = ConnHandle();
+    w.served++;
+    w.idle_since = now_ms;
+}
+
+pid_t CgiPool::retire(Worker* w, bool kill)
+{
+    pid_t pid = w->pid;
+    if (kill)
+        ::kill(pid, SIGKILL);   // Script laeuft noch (Client weg / Timeout)
+    ::close(w->sock);
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        if (workers[i].get() == w)
+        {
+            workers[i].swap(workers.back());
+            workers.pop_back();
+            break;
+        }
+    }
+    return pid;
+}
@@ -0,0 +1,264 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compress.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 21:03:12 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 21:03:12 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Compress.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <strings.h>
+#include <unordered_map>
+
+// komprimierte Varianten pro Thread; grosse Bodies werden nicht gemerkt
+static const size_t GZIP_CACHE_BYTES = 1024 * 1024;
+static const size_t GZIP_CACHE_MAX_BODY = 256 * 1024;
+
+Deflater::~Deflater()
+{
+    if (ready)
+        deflateEnd(&zs);
+}
+
+bool Deflater::init(const std::string& coding, int level)
+{
+    zs = z_stream();
+    // 15 = zlib-Header (deflate), +16 = gzip-Header
+    int bits = (coding == "gzip") ? 15 + 16 : 15;
+    ready = deflateInit2(&zs, level, Z_DEFLATED, bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    return ready;
+}
+
+bool Deflater::push(const char* data, size_t len, std::string& out, bool finish)
+{
+    if (!ready)
+        return false;
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs.avail_in = static_cast<uInt>(len);
+    int flush = finish ? Z_FINISH : Z_SYNC_FLUSH;
+    for (;;)
+    {
+        size_t old = out.size();
+        size_t room = deflateBound(&zs, zs.avail_in) + 64;
+        out.resize(old + room);
+        zs.next_out = reinterpret_cast<Bytef*>(&out[old]);
+        zs.avail_out = static_cast<uInt>(room);
+        int rc = deflate(&zs, flush);
+        out.resize(old + room - zs.avail_out);
+        if (rc == Z_STREAM_ERROR)
+            return false;
+        if (finish ? rc == Z_STREAM_END : (zs.avail_in == 0 && zs.avail_out != 0))
+            return true;
+    }
+}
+
+// string_view: direkt auf dem Header-Wert, ohne Kopie pro Eintrag
+bool acceptsEncoding(std::string_view header, const char* coding)
+{
+    bool star = false;
+    size_t pos = 0;
+    while (pos < header.size())
+    {
+        size_t end = header.find(',', pos);
+        if (end == std::string_view::npos)
+            end = header.size();
+        std::string_view item = header.substr(pos, end - pos);
+        pos = end + 1;
+
+        double q = 1.0;
+        size_t semi = item.find(';');
+        if (semi != std::string_view::npos)
+        {
+            size_t qp = item.find("q=", semi);
+            if (qp != std::string_view::npos)
+            {
+                char num[16] = {};
+                std::string_view v = item.substr(qp + 2, sizeof(num) - 1);
+                v.copy(num, v.size());
+                q = std::strtod(num, NULL);
+            }
+            item = item.substr(0, semi);
+        }
+        size_t first = item.find_first_not_of(" \t");
+        item = first == std::string_view::npos ? std::string_view() : item.substr(first);
+        item = item.substr(0, item.find_last_not_of(" \t") + 1);
+        size_t clen = std::char_traits<char>::length(coding);
+        if (item.size() == clen && strncasecmp(item.data(), coding, clen) == 0)
+            return q > 0;   // explizit genannt: gilt, auch gegen "*"
+        if (item == "*")
+            star = q > 0;
+    }
+    return star;
+}
+
+std::string chooseEncoding(std::string_view accept_encoding)
+{
+    if (acceptsEncoding(accept_encoding, "gzip"))
+        return "gzip";
+    if (acceptsEncoding(accept_encoding, "deflate"))
+        return "deflate";
+    return "";
+}
+
+bool gzipApplies(const LocationConfig& loc, const Response& res)
+{
+    if (!loc.gzip || res.file || res.statusCode < 200 || res.statusCode == 204
+        || res.statusCode == 206 || res.statusCode == 304)
+        return false;
+    if (res.headers.has(H_CONTENT_ENCODING) || res.headers.has(H_CONTENT_RANGE))
+        return false;
+
+    std::string_view type = res.headers.get(H_CONTENT_TYPE);
+    type = type.substr(0, type.find(';'));
+    type = type.substr(0, type.find_last_not_of(" \t") + 1);
+    for (size_t i = 0; i < loc.gzip_types.size(); ++i)
+        if (loc.gzip_types[i] == "*" || (loc.gzip_types[i].size() == type.size()
+                && strncasecmp(loc.gzip_types[i].data(), type.data(), type.size()) == 0))
+            return true;
+    return false;
+}
+
+void addVary(Response& res, const std::string& token)
+{
+    std::string_view vary = res.headers.get(H_VARY);
+    if (vary.empty())
+        res.headers.set(H_VARY, token);
+    else if (vary.find(token) == std::string_view::npos)
+    {
+        char buf[128];
+        int n = snprintf(buf, sizeof(buf), "%.*s, %s", static_cast<int>(vary.size()), vary.data(), token.c_str());
+        if (static_cast<size_t>(n) < sizeof(buf))
+            res.headers.set(H_VARY, std::string_view(buf, static_cast<size_t>(n)));
+        else
+            res.headers.set(H_VARY, std::string(vary) + ", " + token);
+    }
+}
+
+// ====================================================================
+// Cache komprimierter Varianten
+// ====================================================================
+
+static uint64_t fnv1a(const std::string& s)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+namespace
+{
+    struct GzEntry
+    {
+        // Original mit ablegen: der Hash im Schluessel findet nur Kandidaten,
+        // erst der Vergleich entscheidet (Kollision -> fremder Body)
+        std::shared_ptr<const std::string> orig;
+        std::shared_ptr<const std::string> out;   // geht geteilt in die Antworten (body_ref)
+        size_t cost = 0;
+        std::list<std::string>::iterator lru;
+    };
+
+    struct GzCache
+    {
+        std::unordered_map<std::string, GzEntry> entries;
+        std::list<std::string> lru;   // vorne = zuletzt benutzt
+        size_t used = 0;
+        std::string probe;   // Suchschluessel, Kapazitaet bleibt
+
+        void drop(std::unordered_map<std::string, GzEntry>::iterator it)
+        {
+            used -= it->second.cost;
+            lru.erase(it->second.lru);
+            entries.erase(it);
+        }
+    };
+}
+
+static bool deflateAll(const std::string& in, const std::string& coding, int level, std::string& out)
+{
+    Deflater z;
+    return z.init(coding, level) && z.push(in.data(), in.size(), out, true);
+}
+
+void compressResponse(Response& res, const LocationConfig& loc, const std::string& coding)
+{
+    if (!gzipApplies(loc, res))
+        return;
+    addVary(res, "Accept-Encoding");
+    if (coding.empty() || res.bodySize() < loc.gzip_min_length)
+        return;
+
+    static thread_local GzCache cache;
+    const std::string& in = res.body_ref ? *res.body_ref : res.body;
+    // zu gross zum Merken -> auch nicht hashen
+    bool cacheable = in.size() <= GZIP_CACHE_MAX_BODY;
+    std::unordered_map<std::string, GzEntry>::iterator it = cache.entries.end();
+    if (cacheable)
+    {
+        char key[96];
+        snprintf(key, sizeof(key), "%s:%d:%016llx:%zx", coding.c_str(), loc.gzip_comp_level,
+                 static_cast<unsigned long long>(fnv1a(in)), in.size());
+        cache.probe.assign(key);
+        it = cache.entries.find(cache.probe);
+    }
+
+    std::shared_ptr<const std::string> out;
+    // geteilter Body aus dem content_cache: derselbe Zeiger spart den Vergleich
+    if (it != cache.entries.end()
+        && (it->second.orig == res.body_ref || *it->second.orig == in))
+    {
+        cache.lru.splice(cache.lru.begin(), cache.lru, it->second.lru);
+        out = it->second.out;
+    }
+    else
+    {
+        std::string z;
+        if (!deflateAll(in, coding, loc.gzip_comp_level, z) || z.size() >= in.size())
+            return;   // bringt nichts -> unkomprimiert lassen
+        out = std::make_shared<const std::string>(std::move(z));
+        size_t cost = cache.probe.size() + in.size() + out->size();
+        if (cacheable && cost <= GZIP_CACHE_BYTES)
+        {
+            if (it != cache.entries.end())
+                cache.drop(it);   // Hash-Kollision: der neue Body ersetzt den alten
+            while (!cache.lru.empty() && cache.used + cost > GZIP_CACHE_BYTES)
+                cache.drop(cache.entries.find(cache.lru.back()));
+            cache.lru.push_front(cache.probe);
+            GzEntry& e = cache.entries[cache.probe];
+            e.orig = res.body_ref ? res.body_ref : std::make_shared<const std::string>(in);
+            e.out = out;
+            e.cost = cost;
+            e.lru = cache.lru.begin();
+            cache.used += cost;
+        }
+    }
+
+    res.body.clear();   // in ist ab hier ungueltig
+    res.body_ref = out;
+    res.headers.set(H_CONTENT_ENCODING, coding);
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(out->size()));
+    res.headers.erase(H_ACCEPT_RANGES);   // Bereiche wuerden sich aufs Original beziehen
+    // andere Bytes als das Original -> starker Validator wird schwach (wie nginx)
+    std::string_view et = res.headers.get(H_ETAG);
+    if (!et.empty() && et.compare(0, 2, "W/") != 0)
+    {
+        char weak[128];
+        int n = snprintf(weak, sizeof(weak), "W/%.*s", static_cast<int>(et.size()), et.data());
+        if (static_cast<size_t>(n) < sizeof(weak))
+            res.headers.set(H_ETAG, std::string_view(weak, static_cast<size_t>(n)));
+        else
+            res.headers.set(H_ETAG, "W/" + std::string(et));
+    }
+}
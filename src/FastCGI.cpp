@@ -0,0 +1,294 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 15:02:11 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 15:02:11 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FastCGI.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const unsigned char FCGI_VERSION_1  = 1;
+static const unsigned char FCGI_RESPONDER  = 1;
+static const unsigned char FCGI_KEEP_CONN  = 1;
+static const size_t        FCGI_MAX_RECORD = 65535;
+
+// Record-Header + Inhalt, auf 8 Byte aufgefuellt
+static void put_record(std::string& out, unsigned char type, uint16_t id, const char* data, size_t len)
+{
+    unsigned char pad = static_cast<unsigned char>((8 - (len % 8)) % 8);
+    unsigned char h[8] = { FCGI_VERSION_1, type,
+                           static_cast<unsigned char>(id >> 8), static_cast<unsigned char>(id & 0xff),
+                           static_cast<unsigned char>(len >> 8), static_cast<unsigned char>(len & 0xff),
+                           pad, 0 };
+    out.append(reinterpret_cast<char*>(h), 8);
+    out.append(data, len);
+    out.append(pad, '\0');
+}
+
+// Stream-Records (PARAMS/STDIN): in 64k-Stuecke teilen, leerer Record = Ende
+static void put_stream(std::string& out, unsigned char type, uint16_t id, const std::string& data)
+{
+    for (size_t off = 0; off < data.size(); off += FCGI_MAX_RECORD)
+        put_record(out, type, id, data.data() + off, std::min(FCGI_MAX_RECORD, data.size() - off));
+    put_record(out, type, id, "", 0);
+}
+
+static void put_length(std::string& out, size_t n)
+{
+    if (n < 128)
+        out += static_cast<char>(n);
+    else
+    {
+        out += static_cast<char>(((n >> 24) & 0x7f) | 0x80);
+        out += static_cast<char>((n >> 16) & 0xff);
+        out += static_cast<char>((n >> 8) & 0xff);
+        out += static_cast<char>(n & 0xff);
+    }
+}
+
+static std::string encode_params(const std::map<std::string, std::string>& env)
+{
+    std::string out;
+    for (std::map<std::string, std::string>::const_iterator it = env.begin(); it != env.end(); ++it)
+    {
+        put_length(out, it->first.size());
+        put_length(out, it->second.size());
+        out += it->first;
+        out += it->second;
+    }
+    return out;
+}
+
+FcgiConn::FcgiConn(const std::string& a, bool m)
+    : addr(a), mpx(m), sock(-1), connected(false), woff(0), next_id(1)
+{
+}
+
+FcgiConn::~FcgiConn()
+{
+    if (sock >= 0)
+        ::close(sock);
+}
+
+bool FcgiConn::connect()
+{
+    int r;
+    if (addr.compare(0, 5, "unix:") == 0)
+    {
+        struct sockaddr_un sun;
+        std::memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        std::string path = addr.substr(5);
+        if (path.size() >= sizeof(sun.sun_path))
+            return false;
+        std::memcpy(sun.sun_path, path.c_str(), path.size());
+
+        sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sock < 0)
+            return false;
+        r = ::connect(sock, reinterpret_cast<struct sockaddr*>(&sun), sizeof(sun));
+    }
+    else
+    {
+        size_t colon = addr.rfind(':');
+        if (colon == std::string::npos)
+            return false;
+        std::string host = addr.substr(0, colon);
+        std::string port = addr.substr(colon + 1);
+
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_NUMERICSERV;
+        struct addrinfo* ai = NULL;
+        if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &ai) != 0 || !ai)
+            return false;
+
+        sock = ::socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sock < 0)
+        {
+            ::freeaddrinfo(ai);
+            return false;
+        }
+        int one = 1;
+        ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        r = ::connect(sock, ai->ai_addr, ai->ai_addrlen);
+        ::freeaddrinfo(ai);
+    }
+
+    if (r == 0)
+        connected = true;
+    else if (errno != EINPROGRESS)
+    {
+        std::cerr << "[FASTCGI] connect " << addr << ": " << std::strerror(errno) << std::endl;
+        ::close(sock);
+        sock = -1;
+        return false;
+    }
+    return true;
+}
+
+void FcgiConn::submit(const std::shared_ptr<CgiJob>& job, ConnHandle client)
+{
+    uint16_t id = next_id;
+    while (id == 0 || slots.count(id))
+        ++id;
+    next_id = static_cast<uint16_t>(id + 1);
+
+    Slot& s = slots[id];
+    s.job = job;
+    s.client = client;
+
+    unsigned char begin[8] = { 0, FCGI_RESPONDER, FCGI_KEEP_CONN, 0, 0, 0, 0, 0 };
+    put_record(wbuf, FCGI_BEGIN_REQUEST, id, reinterpret_cast<char*>(begin), sizeof(begin));
+    put_stream(wbuf, FCGI_PARAMS, id, encode_params(job->params));
+    put_stream(wbuf, FCGI_STDIN, id, job->input);
+    std::string().swap(job->input);   // liegt jetzt in wbuf
+}
+
+bool FcgiConn::abort(const CgiJob* job)
+{
+    for (std::map<uint16_t, Slot>::iterator it = slots.begin(); it != slots.end(); ++it)
+    {
+        if (it->second.job.get() != job)
+            continue;
+        if (!it->second.aborted)
+        {
+            it->second.aborted = true;
+            put_record(wbuf, FCGI_ABORT_REQUEST, it->first, "", 0);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool FcgiConn::onWritable()
+{
+    if (!connected)
+    {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (::getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0)
+        {
+            std::cerr << "[FASTCGI] connect " << addr << ": " << std::strerror(err) << std::endl;
+            return false;
+        }
+        connected = true;
+    }
+
+    while (woff < wbuf.size())
+    {
+        ssize_t n = ::send(sock, wbuf.data() + woff, wbuf.size() - woff, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            woff += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        return false;
+    }
+    if (woff == wbuf.size())
+    {
+        wbuf.clear();
+        woff = 0;
+    }
+    return true;
+}
+
+bool FcgiConn::onReadable(std::vector<Slot>& done)
+{
+    if (!connected)
+        return true;   // erst onWritable meldet den fertigen connect
+
+    char buf[16384];
+    while (true)
+    {
+        ssize_t n = ::recv(sock, buf, sizeof(buf), 0);
+        if (n > 0)
+        {
+            rbuf.append(buf, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return parse(done);
+        // EOF oder Fehler: Backend hat zugemacht (idle oder mittendrin)
+        parse(done);
+        return false;
+    }
+}
+
+bool FcgiConn::parse(std::vector<Slot>& done)
+{
+    size_t pos = 0;
+    while (rbuf.size() - pos >= 8)
+    {
+        const unsigned char* h = reinterpret_cast<const unsigned char*>(rbuf.data() + pos);
+        if (h[0] != FCGI_VERSION_1)
+        {
+            std::cerr << "[FASTCGI] bad record version from " << addr << std::endl;
+            return false;
+        }
+        uint16_t id   = static_cast<uint16_t>((h[2] << 8) | h[3]);
+        size_t   clen = static_cast<size_t>((h[4] << 8) | h[5]);
+        size_t   total = 8 + clen + h[6];
+        if (rbuf.size() - pos < total)
+            break;
+
+        const char* body = rbuf.data() + pos + 8;
+        std::map<uint16_t, Slot>::iterator it = slots.find(id);
+        if (it != slots.end())
+        {
+            Slot& s = it->second;
+            if (h[1] == FCGI_STDOUT && !s.aborted)
+                s.job->output.append(body, clen);
+            else if (h[1] == FCGI_STDERR)
+                std::cerr << "[FASTCGI] " << std::string(body, clen);
+            else if (h[1] == FCGI_END_REQUEST && clen >= 8)
+            {
+                const unsigned char* e = reinterpret_cast<const unsigned char*>(body);
+                s.job->status = static_cast<int>((e[0] << 24) | (e[1] << 16) | (e[2] << 8) | e[3]);
+                if (e[4] != 0)   // CANT_MPX_CONN / OVERLOADED / UNKNOWN_ROLE
+                    s.job->error = CGI_UPSTREAM_ERROR;
+                s.job->exited = true;
+                done.push_back(s);
+                slots.erase(it);
+            }
+        }
+        pos += total;
+    }
+    rbuf.erase(0, pos);
+    return true;
+}
+
+void FcgiConn::failAll(std::vector<Slot>& out)
+{
+    for (std::map<uint16_t, Slot>::iterator it = slots.begin(); it != slots.end(); ++it)
+    {
+        it->second.job->error = CGI_UPSTREAM_ERROR;
+        it->second.job->exited = true;
+        out.push_back(it->second);
+    }
+    slots.clear();
+}
@@ -0,0 +1,294 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileCache.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 19:12:40 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 19:12:40 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FileCache.hpp"
+#include "config.hpp"
+#include <cerrno>
+#include <ctime>
+#include <cstdio>
+#include <map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static long now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static void fill(FileInfo& info, const struct stat& st)
+{
+    info.is_dir = S_ISDIR(st.st_mode);
+    info.is_reg = S_ISREG(st.st_mode);
+    info.size = st.st_size;
+    info.mtime = st.st_mtim.tv_sec;
+    info.mtime_ns = st.st_mtim.tv_nsec;
+    info.ino = st.st_ino;
+    info.dev = st.st_dev;
+    info.etag = etagFor(info);
+    info.last_modified = httpDate(info.mtime);
+}
+
+static bool same_file(const FileInfo& info, const struct stat& st)
+{
+    return info.ino == st.st_ino && info.dev == st.st_dev && info.size == st.st_size
+        && info.mtime == st.st_mtim.tv_sec && info.mtime_ns == st.st_mtim.tv_nsec;
+}
+
+// open + fstat (2 Syscalls); nicht lesbar -> wenigstens die Metadaten per stat
+static std::shared_ptr<const FileInfo> load(const std::string& path)
+{
+    std::shared_ptr<FileInfo> info = std::make_shared<FileInfo>();
+    struct stat st;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd >= 0 && fstat(fd, &st) == 0)
+    {
+        fill(*info, st);
+        if (info->is_reg)
+            info->file = std::make_shared<FileRef>(fd);
+        else
+            ::close(fd);
+        return info;
+    }
+    if (fd >= 0)
+        ::close(fd);
+    if (::stat(path.c_str(), &st) == 0)
+        fill(*info, st);
+    else
+        info->err = errno ? errno : ENOENT;
+    return info;
+}
+
+// ohne Cache: nur Metadaten, 1 Syscall; der fd kommt erst mit open()
+static std::shared_ptr<const FileInfo> probe(const std::string& path)
+{
+    std::shared_ptr<FileInfo> info = std::make_shared<FileInfo>();
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0)
+        fill(*info, st);
+    else
+        info->err = errno ? errno : ENOENT;
+    return info;
+}
+
+OpenFileCache& OpenFileCache::local()
+{
+    static thread_local OpenFileCache cache;   // jeder Reactor-Thread hat seinen
+    return cache;
+}
+
+std::shared_ptr<const FileInfo> OpenFileCache::lookup(std::string_view view, bool remember_errors)
+{
+    key.assign(view.data(), view.size());
+    const std::string& path = key;
+    bool keep_errors = g_cfg.open_file_cache_errors || remember_errors;
+    if (g_cfg.open_file_cache_max == 0)
+        return probe(path);
+
+    long now = now_ms();
+    expire(now);
+
+    std::unordered_map<std::string, Entry>::iterator it = entries.find(path);
+    if (it != entries.end())
+    {
+        Entry& e = it->second;
+        e.used_ms = now;
+        lru.splice(lru.begin(), lru, e.lru);
+        if (now - e.checked_ms < static_cast<long>(g_cfg.open_file_cache_valid_ms))
+            return e.info;
+
+        // Validierung: unveraendert -> alten fd behalten
+        struct stat st;
+        if (!e.info->err && ::stat(path.c_str(), &st) == 0 && same_file(*e.info, st))
+        {
+            e.checked_ms = now;
+            return e.info;
+        }
+        e.info = load(path);
+        e.checked_ms = now;
+        if (e.info->err && !keep_errors)
+        {
+            std::shared_ptr<const FileInfo> info = e.info;
+            lru.erase(e.lru);
+            entries.erase(it);
+            return info;
+        }
+        return e.info;
+    }
+
+    std::shared_ptr<const FileInfo> info = load(path);
+    if (info->err && !keep_errors)
+        return info;
+
+    if (entries.size() >= g_cfg.open_file_cache_max)
+    {
+        entries.erase(lru.back());   // FileRef schliesst, sobald keine Antwort ihn mehr braucht
+        lru.pop_back();
+    }
+    lru.push_front(path);
+    Entry& e = entries[path];
+    e.info = info;
+    e.checked_ms = now;
+    e.used_ms = now;
+    e.lru = lru.begin();
+    return info;
+}
+
+// mit Cache haelt der Eintrag den fd schon; ohne wird jetzt geoeffnet
+std::shared_ptr<const FileInfo> OpenFileCache::open(std::string_view view)
+{
+    if (g_cfg.open_file_cache_max != 0)
+        return lookup(view);
+    key.assign(view.data(), view.size());
+    return load(key);
+}
+
+// hinten stehen die am laengsten ungenutzten: nur dort nachsehen
+void OpenFileCache::expire(long now)
+{
+    long inactive = static_cast<long>(g_cfg.open_file_cache_inactive_ms);
+    while (!lru.empty())
+    {
+        std::unordered_map<std::string, Entry>::iterator it = entries.find(lru.back());
+        if (now - it->second.used_ms < inactive)
+            break;
+        entries.erase(it);
+        lru.pop_back();
+    }
+}
+
+void OpenFileCache::clear()
+{
+    entries.clear();
+    lru.clear();
+}
+
+// ====================================================================
+// content_cache
+// ====================================================================
+
+std::string httpDate(time_t t)
+{
+    struct tm tm;
+    char buf[64];
+    gmtime_r(&t, &tm);
+    size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
+}
+
+time_t parseHttpDate(const std::string& s)
+{
+    struct tm tm = {};
+    const char* end = strptime(s.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end)
+        return -1;
+    return timegm(&tm);
+}
+
+std::string etagFor(const FileInfo& info)
+{
+    char buf[80];
+    // mit Nanosekunden: gleich grosse Neufassung in derselben Sekunde -> anderes Tag
+    snprintf(buf, sizeof(buf), "\"%lx-%lx-%lx.%lx\"", static_cast<unsigned long>(info.ino),
+             static_cast<unsigned long>(info.size), static_cast<unsigned long>(info.mtime),
+             static_cast<unsigned long>(info.mtime_ns));
+    return buf;
+}
+
+ContentCache& ContentCache::local(const ServerConfig& srv)
+{
+    // pro Worker-Thread ein Cache je server-Block (Config lebt so lange wie der Prozess)
+    static thread_local std::map<const ServerConfig*, std::unique_ptr<ContentCache> > caches;
+    std::unique_ptr<ContentCache>& c = caches[&srv];
+    if (!c)
+        c.reset(new ContentCache(srv.content_cache_size, srv.content_cache_max_file));
+    return *c;
+}
+
+std::shared_ptr<const CachedFile> ContentCache::get(std::string_view view, const FileInfo& info,
+                                                    const std::string& (*mime)(std::string_view))
+{
+    key.assign(view.data(), view.size());
+    const std::string& path = key;
+    if (budget == 0 || !info.is_reg
+        || static_cast<size_t>(info.size) > max_file || static_cast<size_t>(info.size) > budget)
+        return std::shared_ptr<const CachedFile>();
+
+    std::unordered_map<std::string, Entry>::iterator it = entries.find(path);
+    if (it != entries.end())
+    {
+        const CachedFile& f = *it->second.file;
+        if (f.ino == info.ino && f.dev == info.dev && f.size == info.size
+            && f.mtime == info.mtime && f.mtime_ns == info.mtime_ns)
+        {
+            lru.splice(lru.begin(), lru, it->second.lru);
+            return it->second.file;
+        }
+        drop(it);   // Datei hat sich geaendert
+    }
+
+    // ohne open_file_cache bringt info keinen fd mit -> fuers Laden selbst oeffnen
+    std::shared_ptr<FileRef> ref = info.file;
+    if (!ref)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return std::shared_ptr<const CachedFile>();
+        ref = std::make_shared<FileRef>(fd);
+    }
+
+    std::shared_ptr<CachedFile> f = std::make_shared<CachedFile>();
+    f->body.resize(static_cast<size_t>(info.size));
+    size_t got = 0;
+    while (got < f->body.size())
+    {
+        ssize_t n = ::pread(ref->fd, &f->body[got], f->body.size() - got, static_cast<off_t>(got));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        got += static_cast<size_t>(n);
+    }
+    if (got != f->body.size())
+        return std::shared_ptr<const CachedFile>();   // waehrend des Lesens gekuerzt: nicht merken
+
+    f->type = mime(path);
+    f->length = std::to_string(f->body.size());
+    f->etag = info.etag;
+    f->last_modified = info.last_modified;
+    f->mtime = info.mtime;
+    f->mtime_ns = info.mtime_ns;
+    f->size = info.size;
+    f->ino = info.ino;
+    f->dev = info.dev;
+
+    size_t cost = f->body.size() + path.size() + 256;   // grob: Schluessel + Header-Strings
+    while (!lru.empty() && used + cost > budget)
+        drop(entries.find(lru.back()));
+
+    lru.push_front(path);
+    Entry& e = entries[path];
+    e.file = f;
+    e.cost = cost;
+    e.lru = lru.begin();
+    used += cost;
+    return f;
+}
+
+void ContentCache::drop(std::unordered_map<std::string, Entry>::iterator it)
+{
+    used -= it->second.cost;
+    lru.erase(it->second.lru);
+    entries.erase(it);
+}
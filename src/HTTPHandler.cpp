@@ -11,121 +11,108 @@
 /* ************************************************************************** */
 
 #include "../include/HTTPHandler.hpp"
+#include <algorithm>
+#include <charconv>
 #include <iostream>
-#include <sstream>
+#include <strings.h>
 
 RequestParser::RequestParser() {};
 
 RequestParser::~RequestParser() {};
 
-static bool decodeChunkedBody(std::istream& stream, std::string& out,  std::string& err, size_t maxSize = 0)
-{
-    out.clear();
-    std::string line;
-    size_t totalSize = 0;
-
-    while (true)
-    {
-        if (!std::getline(stream, line))
-        {
-            err = "unexpected EOF reading chunk size";
-            return false;
-        }
-        if (!line.empty() && line.back() == '\r')
-            line.pop_back();
-
-        if (line.empty())
-            continue;
+// grosse Upload-Bodies nicht ueber den Request hinaus festhalten
+static const size_t KEEP_BODY = 64 * 1024;
 
-        size_t sem = line.find(';');
-        std::string sizeStr = (sem == std::string::npos) ? line : line.substr(0, sem);
-
-        size_t chunkSize = 0;
-        try
-        {
-            chunkSize = std::stoul(sizeStr, nullptr, 16);
-        }
-        catch (...)
-        {
-            err = "invalid chunk size";
-            return false;
-        }
-
-        if (chunkSize == 0)
-        {
-            while (std::getline(stream, line))
-            {
-                if (!line.empty() && line.back() == '\r')
-                    line.pop_back();
-                if (line.empty())
-                    break;
-            }
-            return true;
-        }
-
-        if (maxSize > 0 && totalSize + chunkSize > maxSize)
-        {
-            err = "chunked body too large (max: " + std::to_string(maxSize) + ")";
-            return false;
-        }
+void Request::reset()
+{
+	keep_alive = false;
+	conn_fd = -1;
+	is_chunked = false;
+	error = 0;
+	content_len = 0;
+	method.clear();
+	path.clear();
+	version.clear();
+	query.clear();
+	cookies.clear();
+	headers.clear();
+	if (body.capacity() > KEEP_BODY)
+		std::string().swap(body);
+	else
+		body.clear();
+}
 
-        std::string chunk;
-        chunk.resize(chunkSize);
-        stream.read(&chunk[0], static_cast<std::streamsize>(chunkSize));
-        std::streamsize got = stream.gcount();
-        if (static_cast<size_t>(got) != chunkSize)
-        {
-            err = "incomplete chunk data";
-            return false;
-        }
+// naechste Zeile ab pos ohne CRLF; letzte Zeile darf ohne '\n' enden
+static bool nextLine(std::string_view in, size_t& pos, std::string_view& line)
+{
+    if (pos >= in.size())
+        return false;
+    size_t nl = in.find('\n', pos);
+    size_t end = (nl == std::string_view::npos) ? in.size() : nl;
+    line = in.substr(pos, end - pos);
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    pos = (nl == std::string_view::npos) ? in.size() : nl + 1;
+    return true;
+}
 
-        out.append(chunk);
-        totalSize += chunkSize;
+static inline std::string_view trim(std::string_view s)
+{
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string_view::npos)
+        return std::string_view();
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return s.substr(a, b - a + 1);
+}
 
-        if (maxSize > 0 && totalSize > maxSize)
-        {
-            err = "chunked body too large (max: " + std::to_string(maxSize) + ")";
-            return false;
-        }
+static bool parseHexSize(std::string_view s, size_t& out)
+{
+    s = trim(s);
+    if (s.empty())
+        return false;
+    std::from_chars_result r = std::from_chars(s.data(), s.data() + s.size(), out, 16);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size();
+}
 
-        int c1 = stream.get();
-        if (c1 == EOF) { err = "missing chunk terminator (EOF)"; return false; }
-        if (c1 == '\n') continue;
-        if (c1 == '\r') {
-            int c2 = stream.get();
-            if (c2 == EOF)
-            {
-                err = "missing chunk terminator (EOF)";
-                return false;
-            }
-            if (c2 == '\n')
-                continue;
-            err = "invalid chunk terminator";
-            return false;
-        }
-        err = "invalid chunk terminator";
+// wie nextLine, aber nur vollstaendige Zeilen (mit '\n'), sonst auf mehr Daten warten
+static bool takeLine(std::string_view in, size_t& pos, std::string_view& line)
+{
+    size_t nl = in.find('\n', pos);
+    if (nl == std::string_view::npos)
         return false;
-    }
+    line = in.substr(pos, nl - pos);
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    pos = nl + 1;
     return true;
 }
 
-bool RequestParser::parseHeaders(const std::string& rawHeaders, Request& req)
+static const size_t MAX_CHUNK_LINE = 4096; // Groessenzeile inkl. Extensions / Trailer-Zeile
+
+static bool chunkError(Request& req, int code, const std::string& err)
 {
-    std::istringstream stream(rawHeaders);
-    std::string line;
+    std::cerr << "Chunked decode error: " << err << std::endl;
+    req.error = code;
+    return false;
+}
 
-    // Request-Line
-    if (!std::getline(stream, line))
+bool RequestParser::parseHeaders(std::string_view rawHeaders, Request& req)
+{
+    std::string_view line;
+    size_t pos = 0;
+
+    // Request-Line (fuehrende Leerzeilen ignorieren, RFC 9112 2.2)
+    do
+    {
+        if (!nextLine(rawHeaders, pos, line))
+            return false;
+    } while (line.empty());
+    if (!parseRequestLine(line, req))
         return false;
-    if (!line.empty() && line.back() == '\r')
-        line.pop_back();
-    parseRequestLine(line, req);
 
     // Headers
-    while (std::getline(stream, line))
+    while (nextLine(rawHeaders, pos, line))
     {
-        if (!line.empty() && line.back() == '\r')
-            line.pop_back();
         if (line.empty())
             break;
         parseHeaderLine(line, req);
@@ -133,26 +120,23 @@ bool RequestParser::parseHeaders(const std::string& rawHeaders, Request& req)
 
     // Connection handling
     if (req.version == "HTTP/1.1")
-        req.keep_alive = !(req.headers.count("Connection") &&
-                          req.headers["Connection"] == "close");
+        req.keep_alive = req.headers.get(H_CONNECTION) != "close";
     else if (req.version == "HTTP/1.0")
-        req.keep_alive = (req.headers.count("Connection") &&
-                         req.headers["Connection"] == "keep-alive");
+        req.keep_alive = req.headers.get(H_CONNECTION) == "keep-alive";
 
     return true;
 }
 
-static bool isChunkedEncoding(const std::string& transferEncoding)
+static bool isChunkedEncoding(std::string_view te)
 {
-    if (transferEncoding.empty())
-        return false;
-    
-    std::string te = transferEncoding;
-    for (size_t i = 0; i < te.size(); ++i)
-        te[i] = std::tolower(te[i]);
-    
-    size_t pos = te.find("chunked");
-    if (pos == std::string::npos)
+    size_t pos = std::string_view::npos;
+    for (size_t i = 0; i + 7 <= te.size(); ++i)
+        if (strncasecmp(te.data() + i, "chunked", 7) == 0)
+        {
+            pos = i;
+            break;
+        }
+    if (pos == std::string_view::npos)
         return false;
     
     if (pos > 0)
@@ -173,147 +157,181 @@ static bool isChunkedEncoding(const std::string& transferEncoding)
     return true;
 }
 
-bool RequestParser::parseBody(std::istringstream& stream, Request& req, const LocationConfig& locationConfig, const ServerConfig& serverConfig)
+bool RequestParser::prepareBody(Request& req, size_t maxBody)
 {
-    const size_t maxBody =
-        (locationConfig.client_max_body_size > 0)
-        ? locationConfig.client_max_body_size
-        : serverConfig.client_max_body_size;
-
-    if (req.headers.count("Transfer-Encoding"))
+    if (req.headers.has(H_TRANSFER_ENCODING))
     {
-        req.is_chunked = isChunkedEncoding(req.headers["Transfer-Encoding"]);
+        req.is_chunked = isChunkedEncoding(req.headers.get(H_TRANSFER_ENCODING));
         
-        if (req.is_chunked && req.headers.count("Content-Length"))
+        if (req.is_chunked && req.headers.has(H_CONTENT_LENGTH))
         {
             std::cerr << "[WARNING] Both Transfer-Encoding and Content-Length present. "
                       << "Ignoring Content-Length per RFC 2616." << std::endl;
-            req.headers.erase("Content-Length");
+            req.headers.erase(H_CONTENT_LENGTH);
         }
     }
-    else if (req.headers.count("Content-Length"))
+    else if (req.headers.has(H_CONTENT_LENGTH))
     {
-        try
-        {
-            req.content_len = std::stoul(req.headers["Content-Length"]);
-            if (maxBody > 0 && req.content_len > maxBody)
-            {
-                req.error = 413;
-                return false;
-            }
-        }
-        catch (...)
-        {
+        std::string_view cl = req.headers.get(H_CONTENT_LENGTH);
+        size_t lead = std::min(cl.find_first_not_of(" \t"), cl.size());
+        if (std::from_chars(cl.data() + lead, cl.data() + cl.size(), req.content_len).ec != std::errc())
             req.content_len = 0;
+        if (maxBody > 0 && req.content_len > maxBody)
+        {
+            req.error = 413;
+            return false;
         }
     }
+    return true;
+}
 
-    if (req.is_chunked) {
-        std::string err;
-        if (!decodeChunkedBody(stream, req.body, err, maxBody))
-        {
-            std::cerr << "Chunked decode error: " << err << std::endl;
-            req.body.clear();
-            req.content_len = 0;
+// Zustandsmaschine ueber ChunkState; kann an jeder Bytegrenze unterbrochen
+// und beim naechsten Read mit den restlichen Bytes fortgesetzt werden
+bool RequestParser::decodeChunks(std::string_view in, size_t& used, ChunkState& state, size_t& need,
+                                 Request& req, size_t maxBody)
+{
+    std::string_view line;
+    size_t pos = 0;
 
-            if (err.find("too large") != std::string::npos)
+    while (state != ChunkState::DONE)
+    {
+        if (state == ChunkState::SIZE)
+        {
+            if (!takeLine(in, pos, line))
             {
-                req.error = 413;
+                if (in.size() - pos > MAX_CHUNK_LINE)
+                    return chunkError(req, 400, "chunk size line too long");
+                break;
             }
-            else
+            if (line.empty())
+                continue;
+
+            size_t sem = line.find(';');
+            if (sem != std::string_view::npos)
+                line = line.substr(0, sem);
+
+            if (!parseHexSize(line, need))
+                return chunkError(req, 400, "invalid chunk size");
+
+            if (need == 0)
             {
-                req.error = 400;
+                state = ChunkState::TRAILER;
+                continue;
             }
-            return false;
+            // laufende Summe pruefen, bevor die Daten ueberhaupt da sind
+            if (maxBody > 0 && (need > maxBody || req.body.size() + need > maxBody))
+                return chunkError(req, 413, "chunked body too large (max: " + std::to_string(maxBody) + ")");
+            state = ChunkState::DATA;
         }
-        req.content_len = req.body.size();
-    }
-    else if (req.content_len > 0)
-    {
-        if (maxBody > 0 && req.content_len > maxBody)
+        else if (state == ChunkState::DATA)
         {
-            req.error = 413;
-            return false;
+            size_t n = std::min(need, in.size() - pos);
+            if (n == 0)
+                break;
+            req.body.append(in.data() + pos, n);
+            pos  += n;
+            need -= n;
+            if (need == 0)
+                state = ChunkState::CRLF_AFTER_DATA;
         }
-
-        std::string body;
-        body.resize(req.content_len);
-        stream.read(&body[0], req.content_len);
-        body.resize(static_cast<size_t>(stream.gcount()));
-        req.body = body;
-    }
-    else
-    {
-        std::string rest;
-        std::getline(stream, rest, '\0');
-        req.body = rest;
-        req.content_len = req.body.size();
-
-        if (maxBody > 0 && req.content_len > maxBody)
+        else if (state == ChunkState::CRLF_AFTER_DATA)
         {
-            req.error = 413;
-            return false;
+            if (pos >= in.size())
+                break;
+            if (in[pos] == '\n')
+            {
+                ++pos;
+                state = ChunkState::SIZE;
+                continue;
+            }
+            if (in[pos] != '\r')
+                return chunkError(req, 400, "invalid chunk terminator");
+            if (pos + 1 >= in.size())
+                break;
+            if (in[pos + 1] != '\n')
+                return chunkError(req, 400, "invalid chunk terminator");
+            pos += 2;
+            state = ChunkState::SIZE;
+        }
+        else // TRAILER: Felder ignorieren bis zur Leerzeile
+        {
+            if (!takeLine(in, pos, line))
+            {
+                if (in.size() - pos > MAX_CHUNK_LINE)
+                    return chunkError(req, 400, "trailer line too long");
+                break;
+            }
+            if (line.empty())
+            {
+                state = ChunkState::DONE;
+                req.content_len = req.body.size();
+            }
         }
     }
-
+    used = pos;
     return true;
 }
 
-static inline std::string trim(const std::string& s)
+static void parseCookieHeader(std::string_view header, Request& req)
 {
-    size_t a = s.find_first_not_of(" \t\r\n");
-    if (a == std::string::npos)
-        return "";
-    size_t b = s.find_last_not_of(" \t\r\n");
-    return s.substr(a, b - a + 1);
-}
-
-static std::map<std::string,std::string> parseCookieHeader(const std::string& header)
-{
-    std::map<std::string,std::string> out;
     size_t pos = 0;
     while (pos < header.size())
     {
         size_t semi = header.find(';', pos);
-        std::string pair = header.substr(pos, (semi==std::string::npos) ? std::string::npos : semi - pos);
+        std::string_view pair = header.substr(pos, (semi==std::string_view::npos) ? std::string_view::npos : semi - pos);
         size_t eq = pair.find('=');
-        if (eq != std::string::npos)
+        if (eq != std::string_view::npos)
         {
-            std::string k = trim(pair.substr(0, eq));
-            std::string v = trim(pair.substr(eq + 1));
-            out[k] = v;
+            std::string_view k = trim(pair.substr(0, eq));
+            std::string_view v = trim(pair.substr(eq + 1));
+            req.cookies[std::pmr::string(k, req.arena())].assign(v);
         }
-        if (semi == std::string::npos)
+        if (semi == std::string_view::npos)
             break;
         pos = semi + 1;
     }
-    return out;
 }
 
-void RequestParser::parseRequestLine(const std::string& line, Request& req)
+// Method SP Target SP Version, Felder durch Whitespace getrennt
+bool RequestParser::parseRequestLine(std::string_view line, Request& req)
 {
-	std::istringstream ss(line);
-	ss >> req.method >> req.path >> req.version;
+	std::string_view parts[3];
+	size_t pos = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		size_t a = line.find_first_not_of(" \t", pos);
+		if (a == std::string_view::npos)
+			break;
+		size_t b = line.find_first_of(" \t", a);
+		if (b == std::string_view::npos)
+			b = line.size();
+		parts[i] = line.substr(a, b - a);
+		pos = b;
+	}
+	req.method.assign(parts[0]);
+	req.path.assign(parts[1]);
+	req.version.assign(parts[2]);
 
 	if (req.method.empty() || req.path.empty() || req.version.empty())
+	{
 		std::cerr << "Invalid request line" << std::endl;
+		return false;
+	}
+	return true;
 }
 
-void RequestParser::parseHeaderLine(const std::string& line, Request& req)
+void RequestParser::parseHeaderLine(std::string_view line, Request& req)
 {
 	size_t pos = line.find(':');
-	if (pos == std::string::npos)
+	if (pos == std::string_view::npos)
 		return;
 
-	std::string key = line.substr(0, pos);
-	std::string value = line.substr(pos + 1);
-
-
-	if (!value.empty() && value[0] == ' ')
-        value.erase(0, 1);
+	std::string_view key = line.substr(0, pos);
+	std::string_view value = trim(line.substr(pos + 1));
 
-    if (key == "Cookie")
-        req.cookies = parseCookieHeader(value);
+    // Feldnamen sind case-insensitive (RFC 9110): "cookie:" zaehlt genauso
+    if (headerId(key) == H_COOKIE)
+        parseCookieHeader(value, req);
     else
-        req.headers[key] = value;
+        req.headers.set(key, value);
 }
@@ -0,0 +1,231 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Headers.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 23:41:27 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 23:41:27 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Headers.hpp"
+#include <strings.h>
+
+static const char* const NAMES[H_COUNT] = {
+    "",
+    "Accept-Encoding",
+    "Accept-Ranges",
+    "Connection",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Range",
+    "Content-Type",
+    "Cookie",
+    "ETag",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "If-Range",
+    "Keep-Alive",
+    "Last-Modified",
+    "Location",
+    "Range",
+    "Server",
+    "Transfer-Encoding",
+    "Vary",
+};
+
+const char* headerName(HeaderId id)
+{
+    return NAMES[id < H_COUNT ? id : H_OTHER];
+}
+
+static bool equalsNoCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+// wenige Namen: erst Laenge und erster Buchstabe, dann der Vergleich
+HeaderId headerId(std::string_view name)
+{
+    if (name.empty())
+        return H_OTHER;
+    char c = static_cast<char>(name[0] | 0x20);
+    for (int i = 1; i < H_COUNT; ++i)
+    {
+        const char* n = NAMES[i];
+        if ((n[0] | 0x20) == c && std::char_traits<char>::length(n) == name.size() && equalsNoCase(n, name))
+            return static_cast<HeaderId>(i);
+    }
+    return H_OTHER;
+}
+
+int HeaderMap::find(HeaderId id) const
+{
+    for (size_t i = 0; i < count; ++i)
+        if (field(i).id == id)
+            return static_cast<int>(i);
+    return -1;
+}
+
+int HeaderMap::find(std::string_view name) const
+{
+    HeaderId id = headerId(name);
+    if (id != H_OTHER)
+        return find(id);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Field& f = field(i);
+        if (f.id == H_OTHER && equalsNoCase(std::string_view(bytes() + f.name_off, f.name_len), name))
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::string_view HeaderMap::get(HeaderId id) const
+{
+    int i = find(id);
+    return i < 0 ? std::string_view() : value(i);
+}
+
+std::string_view HeaderMap::get(std::string_view name) const
+{
+    int i = find(name);
+    return i < 0 ? std::string_view() : value(i);
+}
+
+std::string_view HeaderMap::name(size_t i) const
+{
+    const Field& f = field(i);
+    if (f.id != H_OTHER)
+        return NAMES[f.id];
+    return std::string_view(bytes() + f.name_off, f.name_len);
+}
+
+std::string_view HeaderMap::value(size_t i) const
+{
+    const Field& f = field(i);
+    return std::string_view(bytes() + f.val_off, f.val_len);
+}
+
+// Bytes anhaengen; ist der Puffer voll, zieht alles auf den Heap um.
+// s darf in den eigenen Puffer zeigen (z.B. set(x, get(y)))
+uint32_t HeaderMap::store(std::string_view s)
+{
+    if (heap.empty() && used + s.size() <= INLINE_BYTES)
+    {
+        std::char_traits<char>::move(buf + used, s.data(), s.size());
+        used += s.size();
+        return static_cast<uint32_t>(used - s.size());
+    }
+    if (heap.empty())
+    {
+        std::string moved;
+        moved.reserve(2 * (used + s.size()));
+        moved.assign(buf, used);
+        moved.append(s.data(), s.size());   // s kann noch in buf liegen
+        heap.swap(moved);
+    }
+    else if (s.data() >= heap.data() && s.data() < heap.data() + heap.size())
+    {
+        std::string copy(s);   // append koennte heap verschieben
+        heap.append(copy);
+    }
+    else
+        heap.append(s.data(), s.size());
+    used = heap.size();
+    return static_cast<uint32_t>(used - s.size());
+}
+
+void HeaderMap::push(const Field& f)
+{
+    if (count < INLINE_FIELDS)
+        inl[count] = f;
+    else
+        more.push_back(f);
+    ++count;
+}
+
+void HeaderMap::remove(int i)
+{
+    for (size_t j = static_cast<size_t>(i); j + 1 < count; ++j)
+        field(j) = field(j + 1);
+    --count;
+    if (count >= INLINE_FIELDS)
+        more.pop_back();
+}
+
+// ersetzter Wert bleibt als toter Rest im Puffer; lebt nur so lange wie die Nachricht
+void HeaderMap::set(HeaderId id, std::string_view value)
+{
+    if (id == H_OTHER)
+        return;
+    uint32_t off = store(value);
+    int i = find(id);
+    if (i >= 0)
+    {
+        field(i).val_off = off;
+        field(i).val_len = static_cast<uint32_t>(value.size());
+        return;
+    }
+    Field f = { id, 0, 0, off, static_cast<uint32_t>(value.size()) };
+    push(f);
+}
+
+void HeaderMap::set(std::string_view name, std::string_view value)
+{
+    HeaderId id = headerId(name);
+    if (id != H_OTHER)
+    {
+        set(id, value);
+        return;
+    }
+    int i = find(name);
+    uint32_t off = store(value);
+    if (i >= 0)
+    {
+        field(i).val_off = off;
+        field(i).val_len = static_cast<uint32_t>(value.size());
+        return;
+    }
+    uint32_t name_off = store(name);
+    Field f = { H_OTHER, name_off, static_cast<uint32_t>(name.size()), off, static_cast<uint32_t>(value.size()) };
+    push(f);
+}
+
+void HeaderMap::erase(HeaderId id)
+{
+    int i = find(id);
+    if (i >= 0)
+        remove(i);
+}
+
+void HeaderMap::erase(std::string_view name)
+{
+    int i = find(name);
+    if (i >= 0)
+        remove(i);
+}
+
+void HeaderMap::clear()
+{
+    count = 0;
+    used = 0;
+    more.clear();
+    heap.clear();
+}
+
+void HeaderMap::appendTo(std::string& out) const
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string_view n = name(i);
+        std::string_view v = value(i);
+        out.append(n.data(), n.size());
+        out.append(": ", 2);
+        out.append(v.data(), v.size());
+        out.append("\r\n", 2);
+    }
+}
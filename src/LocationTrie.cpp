@@ -0,0 +1,105 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationTrie.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 22:10:41 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 22:10:41 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "LocationTrie.hpp"
+#include "config.hpp"
+#include <algorithm>
+
+void LocationTrie::build(const std::vector<LocationConfig>& locations)
+{
+    nodes.assign(1, Node());
+    fallback = 0;
+    for (size_t i = 0; i < locations.size(); ++i)
+    {
+        if (!locations[i].path.empty())
+            insert(locations[i].path, static_cast<int>(i));
+        if (locations[i].path == "/" && locations[fallback].path != "/")
+            fallback = i;
+    }
+}
+
+int LocationTrie::child(int node, unsigned char c) const
+{
+    const std::vector<std::pair<unsigned char, int> >& kids = nodes[node].kids;
+    std::vector<std::pair<unsigned char, int> >::const_iterator it =
+        std::lower_bound(kids.begin(), kids.end(), std::make_pair(c, -1));
+    if (it == kids.end() || it->first != c)
+        return -1;
+    return it->second;
+}
+
+// Indizes statt Referenzen: push_back kann nodes verschieben
+void LocationTrie::insert(const std::string& key, int loc)
+{
+    int n = 0;
+    size_t pos = 0;
+    while (pos < key.size())
+    {
+        unsigned char c = key[pos];
+        int k = child(n, c);
+        if (k < 0)
+        {
+            Node leaf;
+            leaf.label = key.substr(pos);
+            leaf.loc = loc;
+            nodes.push_back(leaf);
+            std::vector<std::pair<unsigned char, int> >& kids = nodes[n].kids;
+            kids.insert(std::lower_bound(kids.begin(), kids.end(), std::make_pair(c, -1)),
+                        std::make_pair(c, static_cast<int>(nodes.size() - 1)));
+            return;
+        }
+
+        const std::string& label = nodes[k].label;
+        size_t common = 0;
+        while (common < label.size() && pos + common < key.size() && label[common] == key[pos + common])
+            ++common;
+        if (common < label.size())
+        {
+            // Kante teilen: n -> mid("/da") -> k("ta")
+            Node mid;
+            mid.label = label.substr(0, common);
+            mid.kids.push_back(std::make_pair(static_cast<unsigned char>(label[common]), k));
+            nodes[k].label.erase(0, common);
+            nodes.push_back(mid);
+            int m = static_cast<int>(nodes.size() - 1);
+            std::vector<std::pair<unsigned char, int> >& kids = nodes[n].kids;
+            std::lower_bound(kids.begin(), kids.end(), std::make_pair(c, -1))->second = m;
+            k = m;
+        }
+        n = k;
+        pos += common;
+    }
+    // doppelte location: wie bisher gewinnt die erste
+    if (nodes[n].loc < 0)
+        nodes[n].loc = loc;
+}
+
+size_t LocationTrie::match(const std::string& path) const
+{
+    int best = -1;
+    int n = 0;
+    size_t pos = 0;
+    while (!nodes.empty() && pos < path.size())
+    {
+        int k = child(n, static_cast<unsigned char>(path[pos]));
+        if (k < 0)
+            break;
+        const std::string& label = nodes[k].label;
+        if (path.compare(pos, label.size(), label) != 0)
+            break;
+        pos += label.size();
+        n = k;
+        if (nodes[n].loc >= 0)
+            best = nodes[n].loc;
+    }
+    return best >= 0 ? static_cast<size_t>(best) : fallback;
+}
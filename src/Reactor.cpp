@@ -0,0 +1,193 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Reactor.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 10:12:41 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 10:12:41 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Reactor.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <unistd.h>
+
+// ====================================================================
+// poll backend
+// ====================================================================
+
+static short to_poll(unsigned ev)
+{
+    short p = 0;
+    if (ev & IO_READ)  p |= POLLIN;
+    if (ev & IO_WRITE) p |= POLLOUT;
+    return p;
+}
+
+bool PollReactor::add(int fd, unsigned events)
+{
+    if (fd < 0)
+        return false;
+    if (static_cast<size_t>(fd) >= slot_by_fd.size())
+        slot_by_fd.resize(fd + 1, -1);
+    if (slot_by_fd[fd] >= 0)
+        return modify(fd, events);
+
+    pollfd p{};
+    p.fd = fd;
+    p.events = to_poll(events);
+    p.revents = 0;
+    slot_by_fd[fd] = static_cast<int>(fds.size());
+    fds.push_back(p);
+    return true;
+}
+
+bool PollReactor::modify(int fd, unsigned events)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= slot_by_fd.size() || slot_by_fd[fd] < 0)
+        return false;
+    fds[slot_by_fd[fd]].events = to_poll(events);
+    return true;
+}
+
+// swap-remove: letzter Eintrag rutscht in die Luecke, kein Verschieben
+void PollReactor::remove(int fd)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= slot_by_fd.size() || slot_by_fd[fd] < 0)
+        return;
+    int idx = slot_by_fd[fd];
+    int last = static_cast<int>(fds.size()) - 1;
+    if (idx != last)
+    {
+        fds[idx] = fds[last];
+        slot_by_fd[fds[idx].fd] = idx;
+    }
+    fds.pop_back();
+    slot_by_fd[fd] = -1;
+}
+
+int PollReactor::wait(std::vector<IoReady>& out, int timeout_ms)
+{
+    out.clear();
+    int ready = ::poll(fds.empty() ? NULL : &fds[0], fds.size(), timeout_ms);
+    if (ready <= 0)
+        return ready;
+
+    for (size_t i = 0; i < fds.size() && static_cast<int>(out.size()) < ready; ++i)
+    {
+        short re = fds[i].revents;
+        if (re == 0)
+            continue;
+        fds[i].revents = 0;
+
+        IoReady r;
+        r.fd = fds[i].fd;
+        r.events = 0;
+        if (re & POLLIN)  r.events |= IO_READ;
+        if (re & POLLOUT) r.events |= IO_WRITE;
+        if (re & (POLLHUP | POLLERR | POLLNVAL)) r.events |= IO_ERROR;
+        out.push_back(r);
+    }
+    return static_cast<int>(out.size());
+}
+
+// ====================================================================
+// epoll backend (edge-triggered)
+// ====================================================================
+
+#ifdef __linux__
+
+EpollReactor::EpollReactor() : epfd(::epoll_create1(EPOLL_CLOEXEC)), evbuf(256) {}
+
+EpollReactor::~EpollReactor()
+{
+    if (epfd >= 0)
+        ::close(epfd);
+}
+
+static uint32_t to_epoll(unsigned ev)
+{
+    uint32_t e = EPOLLET;
+    if (ev & IO_READ)  e |= EPOLLIN | EPOLLRDHUP;
+    if (ev & IO_WRITE) e |= EPOLLOUT;
+    return e;
+}
+
+bool EpollReactor::add(int fd, unsigned events)
+{
+    epoll_event e{};
+    e.events = to_epoll(events);
+#ifdef EPOLLEXCLUSIVE
+    // EPOLLEXCLUSIVE erlaubt kein EPOLLRDHUP (EINVAL)
+    if (events & IO_EXCLUSIVE)
+        e.events = (e.events & ~EPOLLRDHUP) | EPOLLEXCLUSIVE;
+#endif
+    e.data.fd = fd;
+    if (::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &e) == 0)
+        return true;
+    if (errno == EEXIST)
+        return modify(fd, events);
+    perror("epoll_ctl(ADD)");
+    return false;
+}
+
+// MOD rearmt auch im ET-Modus: ist der fd schon bereit, kommt sofort ein Event
+bool EpollReactor::modify(int fd, unsigned events)
+{
+    epoll_event e{};
+    e.events = to_epoll(events);
+    e.data.fd = fd;
+    return ::epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &e) == 0;
+}
+
+void EpollReactor::remove(int fd)
+{
+    ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int EpollReactor::wait(std::vector<IoReady>& out, int timeout_ms)
+{
+    out.clear();
+    int n = ::epoll_wait(epfd, &evbuf[0], static_cast<int>(evbuf.size()), timeout_ms);
+    if (n <= 0)
+        return n;
+
+    for (int i = 0; i < n; ++i)
+    {
+        IoReady r;
+        r.fd = evbuf[i].data.fd;
+        r.events = 0;
+        if (evbuf[i].events & (EPOLLIN | EPOLLRDHUP)) r.events |= IO_READ;
+        if (evbuf[i].events & EPOLLOUT)               r.events |= IO_WRITE;
+        if (evbuf[i].events & (EPOLLHUP | EPOLLERR))  r.events |= IO_ERROR;
+        out.push_back(r);
+    }
+    // Puffer voll -> beim naechsten Mal mehr auf einmal abholen
+    if (static_cast<size_t>(n) == evbuf.size())
+        evbuf.resize(evbuf.size() * 2);
+    return n;
+}
+
+#endif
+
+Reactor* Reactor::create(const std::string& backend)
+{
+#ifdef __linux__
+    if (backend == "epoll")
+    {
+        EpollReactor* r = new EpollReactor();
+        if (r->ok())
+            return r;
+        perror("epoll_create1");
+        delete r;
+        std::cerr << "→ falling back to poll\n";
+    }
+#endif
+    if (backend != "poll" && backend != "epoll")
+        std::cerr << "Unknown event_backend '" << backend << "' → using poll\n";
+    return new PollReactor();
+}
@@ -13,6 +13,9 @@
 
 #include "../include/Response.hpp"
 #include "../include/CGIHandler.hpp"
+#include "../include/CgiPool.hpp"
+#include "../include/FileCache.hpp"
+#include "../include/Compress.hpp"
 #include <fstream>
 #include <sstream>
 #include <sys/stat.h>
@@ -21,6 +24,12 @@
 #include <dirent.h>
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "../include/config.hpp"
 #include "../include/Server.hpp"
 
@@ -28,18 +37,51 @@
 ResponseHandler::ResponseHandler() {}
 ResponseHandler::~ResponseHandler() {}
 
+FileRef::~FileRef()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+// Header-Block; der Body bleibt getrennt und wird nicht mitkopiert
+std::string Response::headerBlock() const
+{
+    std::string out;
+    out.reserve(256);
+    headerBlock(out);
+    return out;
+}
+
+void Response::headerBlock(std::string& out) const
+{
+    char status[16];
+    snprintf(status, sizeof(status), "%d ", statusCode);
+    out += "HTTP/1.1 ";
+    out += status;
+    out += reasonPhrase;
+    out += "\r\n";
+	for (size_t i = 0; i < set_cookies.size(); ++i)
+    {
+        out += "Set-Cookie: ";
+        out += set_cookies[i];
+        out += "\r\n";
+    }
+    headers.appendTo(out);
+    out += "\r\n";
+}
+
 // Response-Object to HTTP-string
 std::string Response::toString() const
 {
-    std::ostringstream ss;
-    ss << "HTTP/1.1 " << statusCode << " " << reasonPhrase << "\r\n";
-	for (size_t i = 0; i < set_cookies.size(); ++i)
-        ss << "Set-Cookie: " << set_cookies[i] << "\r\n";
-    for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it)
-        ss << it->first << ": " << it->second << "\r\n";
-    ss << "\r\n";
-    ss << body;
-    return ss.str();
+    return headerBlock() + (body_ref ? *body_ref : body);
+}
+
+void Response::ownBody()
+{
+    if (!body_ref)
+        return;
+    body = *body_ref;
+    body_ref.reset();
 }
 
 // Setzt ein Cookie im Response
@@ -55,33 +97,30 @@ void Response::setCookie(const std::string& name, const std::string& value, cons
 	set_cookies.push_back(sc.str());
 }
 
-static bool isCGIRequest(const std::string& path)
+static bool isCGIRequest(std::string_view p)
 {
-    std::string p = path;
-
-    while (!p.empty() && (p.back() == '\r' || p.back() == '\n' || isspace((unsigned char)p.back())))
-        p.pop_back();
-    size_t start = 0;
-    while (start < p.size() && isspace((unsigned char)p[start])) ++start;
-    if (start) p = p.substr(start);
+    while (!p.empty() && isspace((unsigned char)p.back()))
+        p.remove_suffix(1);
+    while (!p.empty() && isspace((unsigned char)p.front()))
+        p.remove_prefix(1);
 
     size_t q = p.find_first_of("?#");
-    if (q != std::string::npos) p.resize(q);
+    if (q != std::string_view::npos) p = p.substr(0, q);
 
     size_t lastSlash = p.find_last_of('/');
-    std::string last = (lastSlash == std::string::npos) ? p : p.substr(lastSlash + 1);
+    std::string_view last = (lastSlash == std::string_view::npos) ? p : p.substr(lastSlash + 1);
 
     size_t dot = last.find_last_of('.');
-    if (dot == std::string::npos) return false;
-    std::string ext = last.substr(dot + 1);
-
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (dot == std::string_view::npos) return false;
+    std::string_view ext = last.substr(dot + 1);
 
-    return (ext == "py" || ext == "php" || ext == "cgi");
+    return (ext.size() == 2 && strncasecmp(ext.data(), "py", 2) == 0)
+        || (ext.size() == 3 && (strncasecmp(ext.data(), "php", 3) == 0 || strncasecmp(ext.data(), "cgi", 3) == 0));
 }
 
-static std::string urlDecode(const std::string& s) {
-    std::string ret;
+// Pfad-Helfer bauen in den Speicher des Requests (Arena der Verbindung)
+static std::pmr::string urlDecode(std::string_view s, std::pmr::memory_resource* mr = std::pmr::get_default_resource()) {
+    std::pmr::string ret(mr);
     ret.reserve(s.size());
     for (size_t i = 0; i < s.size(); ++i) {
         if (s[i] == '%' && i + 2 < s.size()) {
@@ -97,8 +136,8 @@ static std::string urlDecode(const std::string& s) {
     return ret;
 }
 
-static std::string normalizePath(const std::string& path) {
-    std::string out;
+static std::pmr::string normalizePath(std::string_view path, std::pmr::memory_resource* mr) {
+    std::pmr::string out(mr);
     out.reserve(path.size());
     bool lastSlash = false;
     for (char c : path) {
@@ -113,25 +152,39 @@ static std::string normalizePath(const std::string& path) {
     return out;
 }
 
-static bool containsPathTraversal(const std::string& s) {
-    if (s.find("..") != std::string::npos) return true;
+static bool containsPathTraversal(std::string_view s) {
+    if (s.find("..") != std::string_view::npos) return true;
     return false;
 }
 
-static std::string joinPath(const std::string& a, const std::string& b)
+static std::pmr::string joinPath(std::string_view a, std::string_view b, std::pmr::memory_resource* mr)
 {
-    if (a.empty()) return b;
-    if (b.empty()) return a;
-    std::string out = a;
+    std::pmr::string out(mr);
+    out.reserve(a.size() + b.size() + 1);
+    out.assign(a);
+    if (a.empty() || b.empty()) return out.append(b);
     if (out.back() != '/') out += '/';
-    if (b.front() == '/') out += b.substr(1); else out += b;
+    if (b.front() == '/') out.append(b.substr(1)); else out.append(b);
     return out;
 }
 
+// URL -> Datei: Location-Praefix ab, an das Root haengen (beides aus buildRoutes)
+static std::pmr::string mapToFs(std::string_view url, const LocationConfig& config, std::pmr::memory_resource* mr)
+{
+    if (config.strip_len && url.compare(0, config.strip_len, config.path) == 0)
+    {
+        if (url.size() == config.strip_len)
+            return joinPath(config.fs_root, "/", mr);
+        return joinPath(config.fs_root, url.substr(config.strip_len), mr);
+    }
+    return joinPath(config.fs_root, url, mr);
+}
+
 // MIME-Mapping
-static std::string getMimeType(const std::string& path)
+static const std::string& getMimeType(std::string_view path)
 {
-    static const std::map<std::string, std::string> m = {
+    static const std::string octet = "application/octet-stream";
+    static const std::map<std::string, std::string, std::less<> > m = {
         { "html", "text/html" }, { "htm", "text/html" }, { "css", "text/css" },
         { "js", "application/javascript" }, { "json", "application/json" },
         { "png", "image/png" }, { "jpg", "image/jpeg" }, { "jpeg", "image/jpeg" },
@@ -139,13 +192,15 @@ static std::string getMimeType(const std::string& path)
         { "pdf", "application/pdf" }, { "ico", "image/x-icon" }
     };
     size_t dot = path.find_last_of('.');
-    if (dot == std::string::npos) return "application/octet-stream";
-    std::string ext = path.substr(dot + 1);
+    if (dot == std::string_view::npos || path.size() - dot > 8) return octet;
     // lower
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-    auto it = m.find(ext);
+    char ext[8];
+    size_t n = path.size() - dot - 1;
+    for (size_t i = 0; i < n; ++i)
+        ext[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(path[dot + 1 + i])));
+    auto it = m.find(std::string_view(ext, n));
     if (it != m.end()) return it->second;
-    return "application/octet-stream";
+    return octet;
 }
 
 static std::string htmlEscape(const std::string& str)
@@ -230,14 +285,24 @@ static std::string generateDirectoryListing(const std::string& dirPath, const st
     }
     
     struct dirent* e;
-    std::vector<std::string> entries;
+    std::vector<std::pair<std::string, bool> > entries;   // Name, Verzeichnis?
     
-    // Collect all entries first for sorting
+    // Collect all entries first for sorting; den Typ liefert readdir (d_type),
+    // stat nur, wenn das Dateisystem ihn nicht kennt
     while ((e = readdir(dp)) != NULL)
     {
         std::string name = e->d_name;
         if (name == "." || name == "..") continue;
-        entries.push_back(name);
+        bool isDir = (e->d_type == DT_DIR);
+        if (e->d_type == DT_UNKNOWN || e->d_type == DT_LNK)
+        {
+            struct stat st;
+            std::string fullPath = dirPath;
+            if (fullPath.back() != '/') fullPath += '/';
+            fullPath += name;
+            isDir = (stat(fullPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+        }
+        entries.push_back(std::make_pair(name, isDir));
     }
     closedir(dp);
     
@@ -247,22 +312,13 @@ static std::string generateDirectoryListing(const std::string& dirPath, const st
     // Generate HTML for each entry
     for (size_t i = 0; i < entries.size(); ++i)
     {
-        const std::string& name = entries[i];
+        const std::string& name = entries[i].first;
+        bool isDir = entries[i].second;
         
         std::string itemUrl = urlPrefix;
         if (itemUrl.back() != '/') itemUrl += '/';
         itemUrl += urlEncode(name);
         
-        // Check if it's a directory
-        std::string fullPath = dirPath;
-        if (fullPath.back() != '/') fullPath += '/';
-        fullPath += name;
-        
-        bool isDir = false;
-        struct stat st;
-        if (stat(fullPath.c_str(), &st) == 0)
-            isDir = S_ISDIR(st.st_mode);
-        
         std::string displayName = htmlEscape(name);
         if (isDir) displayName += "/";
         
@@ -274,10 +330,8 @@ static std::string generateDirectoryListing(const std::string& dirPath, const st
     return out.str();
 }
 
-static bool isDirectory(const std::string& path) {
-    struct stat st;
-    if (stat(path.c_str(), &st) != 0) return false;
-    return S_ISDIR(st.st_mode);
+static bool isDirectory(std::string_view path) {
+    return OpenFileCache::local().lookup(path)->is_dir;
 }
 
 std::string ResponseHandler::getStatusMessage(int code)
@@ -285,57 +339,158 @@ std::string ResponseHandler::getStatusMessage(int code)
 	switch (code)
 	{
 		case 200: return "OK";
+		case 206: return "Partial Content";
+		case 304: return "Not Modified";
+		case 400: return "Bad Request";
 		case 404: return "Not Found";
 		case 405: return "Method not Allowed";
         case 413: return "Payload too large";
+        case 416: return "Range Not Satisfiable";
+        case 431: return "Request Header Fields Too Large";
 		default : return "Unkown";
 	}
 }
 
-std::string ResponseHandler::loadErrorPage(const std::string& errorPath, const std::string& fallbackHtml)
+// error_page fuer code: Location vor server-Block vor globalem Default ("" = keine)
+static const std::string& errorPagePath(int code, const LocationConfig& config, const ServerConfig& serverConfig)
+{
+    static const std::string none;
+    std::map<int, std::string>::const_iterator it = config.error_pages.find(code);
+    if (it != config.error_pages.end())
+        return it->second;
+    it = serverConfig.error_pages.find(code);
+    if (it != serverConfig.error_pages.end())
+        return it->second;
+    it = g_cfg.default_error_pages.find(code);
+    if (it != g_cfg.default_error_pages.end())
+        return it->second;
+    return none;
+}
+
+// Body der Fehlerseite nach res; aus dem content_cache geteilt statt kopiert
+void ResponseHandler::loadErrorPage(const std::string& errorPath, std::string_view fallbackHtml,
+                                    const ServerConfig& serverConfig, Response& res)
 {
+    res.body.clear();
+    res.body_ref.reset();
     if (errorPath.empty())
-        return fallbackHtml;
+    {
+        res.body.assign(fallbackHtml);
+        return;
+    }
 
-    if (fileExists(errorPath)) {
-        return readFile(errorPath);
+    std::shared_ptr<const FileInfo> info = OpenFileCache::local().lookup(errorPath);
+    std::shared_ptr<const CachedFile> cf = ContentCache::local(serverConfig).get(errorPath, *info, getMimeType);
+    if (cf)
+    {
+        res.body_ref = std::shared_ptr<const std::string>(cf, &cf->body);
+        return;
+    }
+    if (info->err == 0) {
+        res.body = readFile(errorPath);
+        return;
     }
     std::cerr << "Warning: Error page not found at " << errorPath << std::endl;
-    return fallbackHtml;
+    res.body.assign(fallbackHtml);
 }
 
-std::string ResponseHandler::readFile(const std::string& path)
+// liest ueber den fd aus dem open_file_cache (pread; ohne Cache ein open+fstat)
+std::string ResponseHandler::readFile(std::string_view path)
 {
-	std::ifstream file(path.c_str());
-	if (!file.is_open())
-		return "<h1>Error opening file</h1>";;
+	std::shared_ptr<const FileInfo> info = OpenFileCache::local().open(path);
+	if (!info->file)
+		return "<h1>Error opening file</h1>";
+
+	// bis EOF lesen: size kann innerhalb von open_file_cache_valid veraltet sein
+	std::string out(static_cast<size_t>(info->size) + 1, '\0');
+	size_t got = 0;
+	for (;;)
+	{
+		if (got == out.size())
+			out.resize(out.size() * 2);
+		ssize_t n = ::pread(info->file->fd, &out[got], out.size() - got, static_cast<off_t>(got));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		got += static_cast<size_t>(n);
+	}
+	out.resize(got);
+	return out;
+}
 
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-	return buffer.str();
+// haengt den fd aus dem open_file_cache an die Response, statt die Datei einzulesen
+bool ResponseHandler::openFileBody(std::string_view path, Response& res)
+{
+    std::shared_ptr<const FileInfo> info = OpenFileCache::local().open(path);
+    if (!info->file)
+        return false;
+    res.file = info->file;
+    res.file_offset = 0;
+    res.file_length = static_cast<size_t>(info->size);
+    res.body.clear();
+    res.body_ref.reset();
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.file_length));
+    res.headers.set(H_ETAG, info->etag);
+    res.headers.set(H_LAST_MODIFIED, info->last_modified);
+    return true;
 }
 
-bool ResponseHandler::fileExists(const std::string& path)
+static void setValidators(std::string_view path, Response& res)
 {
-	struct stat buf;
-	return (stat(path.c_str(), &buf) == 0);
+    std::shared_ptr<const FileInfo> info = OpenFileCache::local().lookup(path);
+    if (info->err)
+        return;
+    res.headers.set(H_ETAG, info->etag);
+    res.headers.set(H_LAST_MODIFIED, info->last_modified);
+}
+
+// kleine Dateien aus dem content_cache: Body und Header-Werte liegen fertig vor.
+// Der Body wird geteilt; nur HTML bekommt eine eigene Kopie (User-Farbe)
+bool ResponseHandler::cachedFileBody(std::string_view path, const ServerConfig& serverConfig, Response& res)
+{
+    std::shared_ptr<const FileInfo> info = OpenFileCache::local().lookup(path);
+    std::shared_ptr<const CachedFile> cf = ContentCache::local(serverConfig).get(path, *info, getMimeType);
+    if (!cf)
+        return false;
+    res.statusCode = 200;
+    res.reasonPhrase = getStatusMessage(200);
+    if (cf->type == "text/html")
+    {
+        res.body.reserve(cf->body.size() + 64);
+        res.body.assign(cf->body);
+    }
+    else
+    {
+        res.body.clear();
+        res.body_ref = std::shared_ptr<const std::string>(cf, &cf->body);
+    }
+    res.headers.set(H_CONTENT_TYPE, cf->type);
+    res.headers.set(H_CONTENT_LENGTH, cf->length);
+    res.headers.set(H_ETAG, cf->etag);
+    res.headers.set(H_LAST_MODIFIED, cf->last_modified);
+    return true;
+}
+
+bool ResponseHandler::fileExists(std::string_view path)
+{
+	return OpenFileCache::local().lookup(path)->err == 0;
 }
 
 void setHeaders(Response& res, const Request& req)
 {
-	res.headers["Server"] = "webserv/1.0";
-	res.headers["Connection"] = req.keep_alive ? "keep-alive" : "close";
-	res.headers["Keep-Alive"] = req.keep_alive ? "timeout=5, max=100" : "timeout=0, max=0";
-    res.headers["Content-Type"] = "text/html";
+	res.headers.set(H_SERVER, "webserv/1.0");
+	res.headers.set(H_CONNECTION, req.keep_alive ? "keep-alive" : "close");
+	res.headers.set(H_KEEP_ALIVE, req.keep_alive ? "timeout=5, max=100" : "timeout=0, max=0");
+    res.headers.set(H_CONTENT_TYPE, "text/html");
 
 }
 
 // sanitize/normalize color cookie value, returns empty string on invalid input
-static std::string sanitizeColor(const std::string& raw)
+static std::string sanitizeColor(std::string_view raw)
 {
     if (raw.empty()) return "";
-    std::string s = raw;
-    s = urlDecode(s);
+    std::string s(urlDecode(raw));
     if (s.size() == 6 && s[0] != '#') s = "#" + s;
     if (s.size() != 7) return "";
     for (size_t i = 1; i < s.size(); ++i) {
@@ -347,13 +502,12 @@ static std::string sanitizeColor(const std::string& raw)
 }
 
 // helper: return color cookie value
-static std::string cookieColor(const Request& req)
+static std::string_view cookieColor(const Request& req)
 {
-    if (req.cookies.count("color"))
-        return req.cookies.at("color");
-    if (req.cookies.count("bg"))
-        return req.cookies.at("bg");
-    return "";
+    auto it = req.cookies.find(std::string_view("color"));
+    if (it == req.cookies.end())
+        it = req.cookies.find(std::string_view("bg"));
+    return it == req.cookies.end() ? std::string_view() : std::string_view(it->second);
 }
 
 Response ResponseHandler::makeHtmlResponse(int status, const std::string& body)
@@ -362,29 +516,33 @@ Response ResponseHandler::makeHtmlResponse(int status, const std::string& body)
     r.statusCode = status;
     r.reasonPhrase = getStatusMessage(status);
     r.body = body;
-    r.headers["Content-Type"] = "text/html";
-    r.headers["Content-Length"] = std::to_string(r.body.size());
+    r.headers.set(H_CONTENT_TYPE, "text/html");
+    r.headers.set(H_CONTENT_LENGTH, std::to_string(r.body.size()));
     return r;
 }
 
-bool ResponseHandler::handleDirectoryRequest(const std::string& url, const std::string& fsPath,
-                                   const LocationConfig& config, Response& res)
+bool ResponseHandler::handleDirectoryRequest(const Request& req, std::string_view url, std::string_view fsPath,
+                                   const LocationConfig& config, const ServerConfig& serverConfig,
+                                   Response& res)
 {
-    std::string indexFile = joinPath(fsPath, config.index.empty() ? "index.html" : config.index);
+    std::pmr::string indexFile = joinPath(fsPath, config.index.empty() ? "index.html" : config.index, req.arena());
+    if (cachedFileBody(indexFile, serverConfig, res))
+        return true;
     if (fileExists(indexFile)) {
         res.statusCode = 200;
         res.reasonPhrase = getStatusMessage(200);
         res.body = readFile(indexFile);
-        res.headers["Content-Type"] = getMimeType(indexFile);
-        res.headers["Content-Length"] = std::to_string(res.body.size());
+        res.headers.set(H_CONTENT_TYPE, getMimeType(indexFile));
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+        setValidators(indexFile, res);
         return true;
     }
     if (config.autoindex) {
         res.statusCode = 200;
         res.reasonPhrase = getStatusMessage(200);
-        res.body = generateDirectoryListing(fsPath, url);
-        res.headers["Content-Type"] = "text/html";
-        res.headers["Content-Length"] = std::to_string(res.body.size());
+        res.body = generateDirectoryListing(std::string(fsPath), std::string(url));
+        res.headers.set(H_CONTENT_TYPE, "text/html");
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
         return true;
     }
     res = makeHtmlResponse(404, "<h1>404 Not Found</h1>");
@@ -392,161 +550,426 @@ bool ResponseHandler::handleDirectoryRequest(const std::string& url, const std::
 }
 
 
-bool ResponseHandler::handleFileOrCgi(const Request& req, const std::string& fsPath, const LocationConfig& config, Response& res)
+bool ResponseHandler::handleFileOrCgi(const Request& req, std::string_view fsPath, const LocationConfig& config,
+                                      const ServerConfig& serverConfig, Response& res)
 {
     if (!fileExists(fsPath))
         return false;
 
     std::string ext;
     size_t dot = fsPath.find_last_of('.');
-    if (dot != std::string::npos)
+    if (dot != std::string_view::npos)
         ext = fsPath.substr(dot);
 
+    // CGI laeuft asynchron im Reactor weiter (res.cgi), Antwort kommt vom Server;
+    // mit "fastcgi" geht das Script an das Backend, mit "cgi_pool" an einen
+    // vorgestarteten Interpreter statt fork/exec
     std::map<std::string, std::string>::const_iterator it = config.cgi.find(ext);
-    if (it != config.cgi.end())
+    if (it != config.cgi.end() || isCGIRequest(fsPath))
     {
-        const std::string& execPath = it->second;
-
+        std::string script(fsPath);
         CGIHandler cgi;
-        Response r = cgi.executeWith(req, execPath, fsPath);
+        if (!config.fastcgi.empty())
+            cgi.startFastCgi(req, config, script, res);
+        else if (CgiPool::handles(config, script))
+            cgi.startPooled(req, config, script, res);
+        else
+            cgi.start(req, config, it != config.cgi.end() ? it->second : "", script, res);
+        return true;
+    }
 
-        r.keep_alive = false;
-        setHeaders(r, req);
-        r.headers["Connection"] = "close";
-        r.headers["Keep-Alive"] = "timeout=0, max=0";
+    if (servePrecompressed(req, fsPath, config, serverConfig, res))
+        return true;
+    if (cachedFileBody(fsPath, serverConfig, res))
+        return true;
 
-        if (!r.headers.count("Content-Length"))
-            r.headers["Content-Length"] = std::to_string(r.body.size());
+    res.statusCode = 200;
+    res.reasonPhrase = getStatusMessage(200);
+    res.headers.set(H_CONTENT_TYPE, getMimeType(fsPath));
 
-        res = r;
+    // HTML wird in methodGET noch angepasst (user color) -> muss in den Speicher,
+    // alles andere geht ohne Kopie per sendfile raus
+    if (res.headers.get(H_CONTENT_TYPE) != "text/html" && openFileBody(fsPath, res))
         return true;
+
+    res.body = readFile(fsPath);
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+    setValidators(fsPath, res);
+    return true;
+}
+
+void ResponseHandler::injectUserColor(Response& res, const std::string& color)
+{
+    if (res.headers.get(H_CONTENT_TYPE) != "text/html")
+        return;
+    size_t pos = res.body.find("<body");
+    if (pos != std::string::npos) {
+        size_t end = res.body.find(">", pos);
+        if (end != std::string::npos) {
+            // color ist sanitizeColor()-geprueft: "#rrggbb" oder leer
+            const char* c = color.empty() ? "#ffffff" : color.c_str();
+            char insert[48];
+            int n = snprintf(insert, sizeof(insert), " style=\"--user-color: %s;\"", c);
+            res.body.insert(end, insert, static_cast<size_t>(n));
+            res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+            // Body haengt jetzt vom Cookie ab -> eigener Validator pro Farbe
+            std::string_view etag = res.headers.get(H_ETAG);
+            char tag[128];
+            if (etag.size() > 1 && etag.size() + 8 < sizeof(tag)) {
+                n = snprintf(tag, sizeof(tag), "%.*s-%s\"", static_cast<int>(etag.size() - 1), etag.data(), c + 1);
+                res.headers.set(H_ETAG, std::string_view(tag, static_cast<size_t>(n)));
+                res.headers.set(H_VARY, "Cookie");
+            }
+        }
     }
+}
+
+// gzip_static/brotli_static: vorkomprimierte Nachbardatei (file.br, file.gz) statt file,
+// wenn der Client sie annimmt und sie nicht aelter als das Original ist.
+// Die Nachbarn laufen ueber den open_file_cache (auch "gibt es nicht" wird gemerkt).
+bool ResponseHandler::servePrecompressed(const Request& req, std::string_view fsPath, const LocationConfig& config,
+                                         const ServerConfig& serverConfig, Response& res)
+{
+    if (!config.gzip_static && !config.brotli_static)
+        return false;
+    const std::string& type = getMimeType(fsPath);
+    if (type == "text/html")
+        return false;   // bekommt noch die User-Farbe eingesetzt, geht nur unkomprimiert
+    res.headers.set(H_VARY, "Accept-Encoding");
 
+    std::string_view ae = req.headers.get(H_ACCEPT_ENCODING);
+    if (ae.empty())
+        return false;
 
-    if (isCGIRequest(fsPath)) {
-        CGIHandler cgi;
-        Request req_cgi = req;
-        req_cgi.path = fsPath;
-        res = cgi.execute(req_cgi);
-        res.keep_alive = false;
-        res.headers["Connection"] = "close";
-        res.headers["Keep-Alive"] = "timeout=0, max=0";
-        if (!res.headers.count("Content-Length"))
-            res.headers["Content-Length"] = std::to_string(res.body.size());
+    static const struct { const char* coding; const char* ext; bool LocationConfig::*on; } kinds[] = {
+        { "br", ".br", &LocationConfig::brotli_static },
+        { "gzip", ".gz", &LocationConfig::gzip_static },
+    };
+    std::shared_ptr<const FileInfo> orig = OpenFileCache::local().lookup(fsPath);
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); ++i)
+    {
+        if (!(config.*kinds[i].on) || !acceptsEncoding(ae, kinds[i].coding))
+            continue;
+        std::pmr::string side(fsPath, req.arena());
+        side += kinds[i].ext;
+        std::shared_ptr<const FileInfo> info = OpenFileCache::local().lookup(side, true);
+        if (info->err || !info->is_reg || info->mtime < orig->mtime)
+            continue;
+        if (!cachedFileBody(side, serverConfig, res) && !openFileBody(side, res))
+            continue;
+        res.statusCode = 200;
+        res.reasonPhrase = getStatusMessage(200);
+        res.headers.set(H_CONTENT_TYPE, type);
+        res.headers.set(H_CONTENT_ENCODING, kinds[i].coding);
         return true;
     }
+    return false;
+}
 
-    res.statusCode = 200;
-    res.reasonPhrase = getStatusMessage(200);
-    res.body = readFile(fsPath);
-    res.headers["Content-Type"] = getMimeType(fsPath);
-    res.headers["Content-Length"] = std::to_string(res.body.size());
+// If-None-Match: Liste von Entity-Tags oder "*"; schwacher Vergleich (W/ ignorieren)
+static bool etagMatches(std::string_view list, std::string_view etag)
+{
+    std::string_view strong = etag.compare(0, 2, "W/") == 0 ? etag.substr(2) : etag;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t end = list.find(',', pos);
+        if (end == std::string_view::npos)
+            end = list.size();
+        std::string_view tag = list.substr(pos, end - pos);
+        size_t first = tag.find_first_not_of(" \t");
+        tag = first == std::string_view::npos ? std::string_view() : tag.substr(first);
+        tag = tag.substr(0, tag.find_last_not_of(" \t") + 1);
+        if (tag.compare(0, 2, "W/") == 0)
+            tag.remove_prefix(2);
+        if (tag == "*" || tag == strong)
+            return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+// RFC 7232: If-None-Match hat Vorrang, If-Modified-Since zaehlt nur ohne ihn.
+// Validatoren stammen aus dem open_file_cache -> kein extra stat()
+void ResponseHandler::checkNotModified(const Request& req, Response& res)
+{
+    if (res.statusCode != 200 || !res.headers.has(H_ETAG))
+        return;
+
+    bool fresh = false;
+    if (req.headers.has(H_IF_NONE_MATCH))
+        fresh = etagMatches(req.headers.get(H_IF_NONE_MATCH), res.headers.get(H_ETAG));
+    else if (req.headers.has(H_IF_MODIFIED_SINCE) && res.headers.has(H_LAST_MODIFIED))
+    {
+        std::string ims(req.headers.get(H_IF_MODIFIED_SINCE));
+        std::string lm(res.headers.get(H_LAST_MODIFIED));
+        time_t since = parseHttpDate(ims);
+        time_t mtime = parseHttpDate(lm);
+        fresh = (ims == lm) || (since != -1 && mtime != -1 && mtime <= since);
+    }
+    if (!fresh)
+        return;
+
+    // 304 ohne Body; Repraesentations-Header fallen weg, ETag/Vary bleiben
+    res.statusCode = 304;
+    res.reasonPhrase = getStatusMessage(304);
+    res.body.clear();
+    res.body_ref.reset();
+    res.file.reset();
+    res.file_offset = 0;
+    res.file_length = 0;
+    res.headers.erase(H_CONTENT_LENGTH);
+    res.headers.erase(H_CONTENT_TYPE);
+}
+
+// bis zu so vielen Bereichen pro Request, mehr -> ganze Datei (wie nginx max_ranges)
+static const size_t MAX_RANGES = 16;
+
+struct ByteRange
+{
+    size_t start;
+    size_t len;
+};
+
+static bool parseOffset(const std::string& s, size_t& out)
+{
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos || s.size() > 19)
+        return false;
+    out = std::strtoull(s.c_str(), NULL, 10);
     return true;
 }
 
+// "bytes=0-99,200-,-500" gegen eine Groesse aufloesen (RFC 7233).
+// false = syntaktisch ungueltig -> Header ignorieren; leeres out = nichts erfuellbar
+static bool parseRanges(const std::string& header, size_t size, std::vector<ByteRange>& out)
+{
+    if (strncasecmp(header.c_str(), "bytes=", 6) != 0)
+        return false;
+    size_t pos = 6;
+    size_t count = 0;
+    while (pos <= header.size())
+    {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos)
+            end = header.size();
+        std::string spec = header.substr(pos, end - pos);
+        spec.erase(0, spec.find_first_not_of(" \t"));
+        spec.erase(spec.find_last_not_of(" \t") + 1);
+        pos = end + 1;
+        if (spec.empty())
+            continue;
+        if (++count > MAX_RANGES)
+            return false;
+
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos)
+            return false;
+        std::string a = spec.substr(0, dash);
+        std::string b = spec.substr(dash + 1);
+        size_t first, last;
+        if (a.empty())
+        {
+            // Suffix: die letzten n Bytes
+            if (!parseOffset(b, last))
+                return false;
+            if (last == 0 || size == 0)
+                continue;
+            first = last >= size ? 0 : size - last;
+            last = size - 1;
+        }
+        else
+        {
+            if (!parseOffset(a, first))
+                return false;
+            if (b.empty())
+                last = size ? size - 1 : 0;
+            else if (!parseOffset(b, last) || last < first)
+                return false;
+            if (first >= size)
+                continue;   // nicht erfuellbar, andere Bereiche evtl. schon
+            if (last >= size)
+                last = size - 1;
+        }
+        ByteRange r = { first, last - first + 1 };
+        out.push_back(r);
+    }
+    return count > 0;
+}
+
+// If-Range: starker ETag-Vergleich oder exakt das Last-Modified-Datum
+static bool ifRangeMatches(const Request& req, const Response& res)
+{
+    if (!req.headers.has(H_IF_RANGE))
+        return true;
+    std::string_view ir = req.headers.get(H_IF_RANGE);
+    if (!ir.empty() && (ir[0] == '"' || ir.compare(0, 2, "W/") == 0))
+    {
+        std::string_view etag = res.headers.get(H_ETAG);
+        return !etag.empty() && etag.compare(0, 2, "W/") != 0 && etag == ir;
+    }
+    return res.headers.has(H_LAST_MODIFIED) && res.headers.get(H_LAST_MODIFIED) == ir;
+}
+
+void ResponseHandler::applyRange(const Request& req, Response& res)
+{
+    if (res.statusCode != 200 || !res.headers.has(H_ETAG))
+        return;
+    res.headers.set(H_ACCEPT_RANGES, "bytes");
+
+    if (!req.headers.has(H_RANGE) || !ifRangeMatches(req, res))
+        return;
+    std::string range(req.headers.get(H_RANGE));
+    res.ownBody();   // Bereiche aus dem Speicher schneiden
+
+    bool from_file = res.file && res.body.empty();
+    size_t size = from_file ? res.file_length : res.body.size();
+    std::vector<ByteRange> ranges;
+    if (!parseRanges(range, size, ranges))
+        return;
+
+    std::string total = std::to_string(size);
+    if (ranges.empty())
+    {
+        res.statusCode = 416;
+        res.reasonPhrase = getStatusMessage(416);
+        res.file.reset();
+        res.body = "<h1>416 Range Not Satisfiable</h1>";
+        res.headers.set(H_CONTENT_TYPE, "text/html");
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+        res.headers.set(H_CONTENT_RANGE, "bytes */" + total);
+        return;
+    }
+
+    res.statusCode = 206;
+    res.reasonPhrase = getStatusMessage(206);
+    if (ranges.size() == 1)
+    {
+        const ByteRange& r = ranges[0];
+        res.headers.set(H_CONTENT_RANGE, "bytes " + std::to_string(r.start) + "-"
+            + std::to_string(r.start + r.len - 1) + "/" + total);
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(r.len));
+        if (from_file)
+        {
+            res.file_offset += static_cast<off_t>(r.start);
+            res.file_length = r.len;
+        }
+        else
+            res.body = res.body.substr(r.start, r.len);
+        return;
+    }
+
+    // multipart/byteranges: aus der Datei als Kopf + sendfile-Abschnitt je Teil,
+    // aus dem Speicher direkt zusammengesetzt
+    static thread_local unsigned long seq = 0;
+    char boundary[48];
+    snprintf(boundary, sizeof(boundary), "%08lx%08lx", static_cast<unsigned long>(time(NULL)), ++seq);
+    std::string type(res.headers.get(H_CONTENT_TYPE));
+    std::string body;
+    size_t length = 0;
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        const ByteRange& r = ranges[i];
+        std::string head = "\r\n--" + std::string(boundary) + "\r\nContent-Type: " + type
+            + "\r\nContent-Range: bytes " + std::to_string(r.start) + "-"
+            + std::to_string(r.start + r.len - 1) + "/" + total + "\r\n\r\n";
+        length += head.size() + r.len;
+        if (from_file)
+        {
+            Response::FilePart part = { head, res.file_offset + static_cast<off_t>(r.start), r.len };
+            res.file_parts.push_back(part);
+        }
+        else
+            body += head + res.body.substr(r.start, r.len);
+    }
+    std::string closing = "\r\n--" + std::string(boundary) + "--\r\n";
+    body += closing;
+    length += closing.size();
+    res.body = body;
+    res.headers.set(H_CONTENT_TYPE, "multipart/byteranges; boundary=" + std::string(boundary));
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(from_file ? length : res.body.size()));
+}
+
+// gzip: Kodierung aussuchen; CGI merkt sie sich fuer finish()/beginStream()
+void ResponseHandler::compressOutput(const Request& req, const LocationConfig& locConfig, Response& res)
+{
+    if (!locConfig.gzip)
+        return;
+    std::string coding = chooseEncoding(req.headers.get(H_ACCEPT_ENCODING));
+    if (res.cgi)
+    {
+        res.cgi->gzip = &locConfig;
+        res.cgi->encoding = coding;
+        return;
+    }
+    compressResponse(res, locConfig, coding);
+}
+
 static std::string extractValidatedColor(const Request& req)
 {
     return sanitizeColor(cookieColor(req));
 }
 
 Response& ResponseHandler::methodGET(const Request& req, Response& res, const LocationConfig& config, const ServerConfig& serverConfig) {
-    std::string url = urlDecode(req.path);
+    std::pmr::string url = urlDecode(req.path, req.arena());
     if (url.empty()) url = "/";
-    url = normalizePath(url);
+    url = normalizePath(url, req.arena());
 
     // security check
     if (containsPathTraversal(url)) {
         res.statusCode = 403;
         res.reasonPhrase = getStatusMessage(403);
-        std::string fallback = "<h1>403 Forbidden</h1>";
-        std::string errorPath;
-        if (config.error_pages.count(403))
-        {
-            errorPath = config.error_pages.at(403);
-        }
-        else if (serverConfig.error_pages.count(403))
-        {
-            errorPath = serverConfig.error_pages.at(403);
-        }
-        else if (g_cfg.default_error_pages.count(403))
-        {
-            errorPath = g_cfg.default_error_pages.at(403);
-        }
-        res.body = loadErrorPage(errorPath, fallback);
-        res.headers["Content-Type"] = "text/html";
-        res.headers["Content-Length"] = std::to_string(res.body.size());
+        loadErrorPage(errorPagePath(403, config, serverConfig), "<h1>403 Forbidden</h1>", serverConfig, res);
+        res.headers.set(H_CONTENT_TYPE, "text/html");
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(res.bodySize()));
         return res;
     }
 
     // prepare filesystem path relative to location root
-    std::string fsPath = config.root.empty() ? std::string(".") : config.root;
-    std::string trimmedUrl = url;
-    if (!config.path.empty() && config.path != "/" && trimmedUrl.find(config.path) == 0) {
-        trimmedUrl = trimmedUrl.substr(config.path.length());
-        if (trimmedUrl.empty()) trimmedUrl = "/";
-    }
-    fsPath = joinPath(fsPath, trimmedUrl);
+    std::pmr::string fsPath = mapToFs(url, config, req.arena());
 
     std::string color = extractValidatedColor(req);
 
     if (isDirectory(fsPath)) {
-        handleDirectoryRequest(url, fsPath, config, res);
+        handleDirectoryRequest(req, url, fsPath, config, serverConfig, res);
+        checkNotModified(req, res);
+        applyRange(req, res);
         return res;
     }
 
-    if (handleFileOrCgi(req, fsPath, config, res)) {
-        if (res.headers["Content-Type"] == "text/html") {
-            size_t pos = res.body.find("<body");
-            if (pos != std::string::npos) {
-                size_t end = res.body.find(">", pos);
-                if (end != std::string::npos) {
-                    std::string insert = " style=\"--user-color: " +
-                        (color.empty() ? std::string("#ffffff") : color) + ";\"";
-                    res.body.insert(end, insert);
-                    res.headers["Content-Length"] = std::to_string(res.body.size());
-                }
-            }
+    if (handleFileOrCgi(req, fsPath, config, serverConfig, res)) {
+        if (res.cgi) {
+            // Ausgabe gibt es erst spaeter, Farbe wird beim Abschluss eingesetzt
+            res.cgi->inject_color = true;
+            res.cgi->color = color;
+            return res;
         }
+        injectUserColor(res, color);
+        checkNotModified(req, res);
+        applyRange(req, res);
         return res;
     }
 
     // not found – 404-BLOCK
     res.statusCode = 404;
     res.reasonPhrase = getStatusMessage(404);
-    std::string errorPath;
-    if (config.error_pages.count(404)) {
-        errorPath = config.error_pages.at(404);
-    } else if (serverConfig.error_pages.count(404)) {
-        errorPath = serverConfig.error_pages.at(404);
-    } else if (g_cfg.default_error_pages.count(404)) {
-        errorPath = g_cfg.default_error_pages.at(404);
-    }
-
-    std::string fallback = "<h1>404 Not Found</h1>";
-    res.body = loadErrorPage(errorPath, fallback);
-    res.headers["Content-Type"] = "text/html";
-    res.headers["Content-Length"] = std::to_string(res.body.size());
+    loadErrorPage(errorPagePath(404, config, serverConfig), "<h1>404 Not Found</h1>", serverConfig, res);
+    res.headers.set(H_CONTENT_TYPE, "text/html");
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.bodySize()));
     return res;
 }
 
 Response& ResponseHandler::methodPOST(const Request& req, Response& res, const LocationConfig& config)
 {
-    std::string url = urlDecode(req.path);
+    std::pmr::string url = urlDecode(req.path, req.arena());
     if (url.empty()) url = "/";
-    url = normalizePath(url);
+    url = normalizePath(url, req.arena());
 
     if (containsPathTraversal(url)) {
         res = makeHtmlResponse(403, "<h1>403 Forbidden</h1>");
         return res;
     }
 
-    std::string fsPath = config.root.empty() ? std::string(".") : config.root;
-    std::string trimmedUrl = url;
-    if (!config.path.empty() && config.path != "/" && trimmedUrl.find(config.path) == 0) {
-        trimmedUrl = trimmedUrl.substr(config.path.length());
-        if (trimmedUrl.empty()) trimmedUrl = "/";
-    }
-    fsPath = joinPath(fsPath, trimmedUrl);
+    std::pmr::string fsPath = mapToFs(url, config, req.arena());
 
     std::string ext;
     size_t dot = fsPath.find_last_of('.');
@@ -554,36 +977,16 @@ Response& ResponseHandler::methodPOST(const Request& req, Response& res, const L
         ext = fsPath.substr(dot);
 
     std::map<std::string, std::string>::const_iterator it = config.cgi.find(ext);
-    if (it != config.cgi.end())
+    if (it != config.cgi.end() || isCGIRequest(fsPath))
     {
-        const std::string& execPath = it->second;
-
+        std::string script(fsPath);
         CGIHandler cgi;
-        Response r = cgi.executeWith(req, execPath, fsPath);
-
-        r.keep_alive = false;
-        setHeaders(r, req);
-        r.headers["Connection"] = "close";
-        r.headers["Keep-Alive"] = "timeout=0, max=0";
-
-        if (!r.headers.count("Content-Length"))
-            r.headers["Content-Length"] = std::to_string(r.body.size());
-
-        res = r;
-        return res;
-    }
-
-    if (isCGIRequest(fsPath))
-    {
-        CGIHandler cgi;
-        Request req_cgi = req;
-        req_cgi.path = fsPath;
-        res = cgi.execute(req_cgi);
-        res.keep_alive = false;
-        res.headers["Connection"] = "close";
-        res.headers["Keep-Alive"] = "timeout=0, max=0";
-        if (!res.headers.count("Content-Length"))
-            res.headers["Content-Length"] = std::to_string(res.body.size());
+        if (!config.fastcgi.empty())
+            cgi.startFastCgi(req, config, script, res);
+        else if (CgiPool::handles(config, script))
+            cgi.startPooled(req, config, script, res);
+        else
+            cgi.start(req, config, it != config.cgi.end() ? it->second : "", script, res);
         return res;
     }
 
@@ -594,9 +997,7 @@ Response& ResponseHandler::methodPOST(const Request& req, Response& res, const L
 #ifdef DEBUG
 	std::cout << "POST data dir: " << dir << std::endl;
 #endif
-	std::string contentType;
-	if (req.headers.count("Content-Type"))
-		contentType = req.headers.find("Content-Type")->second;
+	std::string contentType(req.headers.get(H_CONTENT_TYPE));
 
     // Multipart-Formular-Upload
 	if (contentType.find("multipart/form-data") != std::string::npos)
@@ -659,6 +1060,7 @@ Response& ResponseHandler::methodPOST(const Request& req, Response& res, const L
 					{
 						out.write(fileContent.data(), fileContent.size());
 						out.close();
+						OpenFileCache::local().clear();
 
 						res.statusCode = 200;
 						res.reasonPhrase = getStatusMessage(200);
@@ -684,13 +1086,14 @@ Response& ResponseHandler::methodPOST(const Request& req, Response& res, const L
 		{
 			out.write(req.body.data(), req.body.size());
 			out.close();
+			OpenFileCache::local().clear();
 
 			res.statusCode = 200;
 			res.reasonPhrase = getStatusMessage(200);
 			res.body = "<h1>POST stored successfully!</h1><p>Saved as " + filename + "</p>";
 		}
 	}
-    res.headers["Content-Length"] = std::to_string(res.body.size());
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
 	return res;
 }
 
@@ -716,7 +1119,7 @@ Response& ResponseHandler::methodDELETE(const Request& req, Response& res, const
     if (start > 0)
         filename = filename.substr(start);
 
-    filename = urlDecode(filename);
+    filename.assign(urlDecode(filename));
 
     if (filename.empty()) {
         res = makeHtmlResponse(400, "<h1>400 Bad Request - No filename specified</h1>");
@@ -792,8 +1195,8 @@ Response& ResponseHandler::methodDELETE(const Request& req, Response& res, const
         res.statusCode = 404;
         res.reasonPhrase = getStatusMessage(404);
         res.body = "<h1>404 File '" + htmlEscape(filename) + "' not found.</h1>";
-        res.headers["Content-Type"] = "text/html";
-        res.headers["Content-Length"] = std::to_string(res.body.size());
+        res.headers.set(H_CONTENT_TYPE, "text/html");
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
         return res;
     }
     
@@ -817,19 +1220,20 @@ Response& ResponseHandler::methodDELETE(const Request& req, Response& res, const
 
     if (std::remove(filepath.c_str()) == 0)
     {
+        OpenFileCache::local().clear();
         res.statusCode = 200;
         res.reasonPhrase = getStatusMessage(200);
         res.body = "<h1>File '" + htmlEscape(filename) + "' deleted successfully.</h1>";
-        res.headers["Content-Type"] = "text/html";
-        res.headers["Content-Length"] = std::to_string(res.body.size());
+        res.headers.set(H_CONTENT_TYPE, "text/html");
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
     }
     else
     {
         res.statusCode = 500;
         res.reasonPhrase = "Internal Server Error";
         res.body = "<h1>500 Internal Server Error - Failed to delete file</h1>";
-        res.headers["Content-Type"] = "text/html";
-        res.headers["Content-Length"] = std::to_string(res.body.size());
+        res.headers.set(H_CONTENT_TYPE, "text/html");
+        res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
     }
     
     return res;
@@ -842,41 +1246,32 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
     Response res;
     res.statusCode = req.error;
     res.reasonPhrase = getStatusMessage(req.error);
-    res.body = "<h1>413 Payload too large.</h1>";
-
-    std::string errorPath;
-    if (locConfig.error_pages.count(req.error)) {
-        errorPath = locConfig.error_pages.at(req.error);
-    } else if (serverConfig.error_pages.count(req.error)) {
-        errorPath = serverConfig.error_pages.at(req.error);
-    } else if (g_cfg.default_error_pages.count(req.error)) {
-        errorPath = g_cfg.default_error_pages.at(req.error);
-    }
 
     std::string fallback = "<h1>" + std::to_string(req.error) + " " + res.reasonPhrase + "</h1>";
-    res.body = loadErrorPage(errorPath, fallback);
+    loadErrorPage(errorPagePath(req.error, locConfig, serverConfig), fallback, serverConfig, res);
 
-    res.headers["Content-Type"] = "text/html";
-    res.headers["Content-Length"] = std::to_string(res.body.size());
+    res.headers.set(H_CONTENT_TYPE, "text/html");
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.bodySize()));
     res.keep_alive = false;
+    compressOutput(req, locConfig, res);
     return res;
     }
 
     Response res;
     res.keep_alive = req.keep_alive;
 
+    // Default-Headers
+    setHeaders(res, req);
+
+#ifdef DEBUG
+    // nur fuer die Ausgabe; die eigentliche Aufloesung macht mapToFs()
     std::string fullPath = locConfig.root;
-    std::string decodedPath = urlDecode(req.path);
+    std::pmr::string decodedPath = urlDecode(req.path);
     if (decodedPath.empty() || decodedPath == "/") {
         fullPath += "/" + (locConfig.index.empty() ? "index.html" : locConfig.index);
     } else {
-        fullPath += decodedPath;
+        fullPath.append(decodedPath);
     }
-
-    // Default-Headers
-    setHeaders(res, req);
-
-#ifdef DEBUG
     printf("Full path: %s\n", fullPath.c_str());
     for (size_t i = 0; i < locConfig.methods.size(); ++i)
         std::cout << locConfig.methods[i] << " ";
@@ -885,19 +1280,25 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 
     auto methodIt = std::find(locConfig.methods.begin(), locConfig.methods.end(), req.method);
     if (req.method == "GET" && methodIt != locConfig.methods.end()) {
-        return methodGET(req, res, locConfig, serverConfig);
+        methodGET(req, res, locConfig, serverConfig);
+        compressOutput(req, locConfig, res);
+        return res;
     } else if (req.method == "POST" && methodIt != locConfig.methods.end()) {
-        return methodPOST(req, res, locConfig);
+        methodPOST(req, res, locConfig);
+        compressOutput(req, locConfig, res);
+        return res;
     } else if (req.method == "DELETE" && methodIt != locConfig.methods.end()) {
-        return methodDELETE(req, res, locConfig);
+        methodDELETE(req, res, locConfig);
+        compressOutput(req, locConfig, res);
+        return res;
     } else {
         res.statusCode = 405;
         res.reasonPhrase = getStatusMessage(405);
         res.body = "<h1>405 Method Not Allowed</h1>";
-        res.headers["Content-Type"] = "text/html";
+        res.headers.set(H_CONTENT_TYPE, "text/html");
     }
 
-    res.headers["Content-Length"] = std::to_string(res.body.size());
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
 
 #ifdef DEBUG
     std::cout << "method : " << req.method << std::endl;
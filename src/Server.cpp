@@ -11,15 +11,24 @@
 /* ************************************************************************** */
 
 #include "Server.hpp"
+#include "Compress.hpp"
 #include <unistd.h>
 #include <limits.h>
+#include <cerrno>
+#include <memory>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#ifdef __linux__
+# include <sys/prctl.h>
+#endif
 
-// globals
-static std::vector<pollfd>     fds;
-static std::unordered_set<int> listener_fds;
-static std::vector<Client>     clients;
-static std::unordered_map<int /*port*/, std::vector<size_t> /*server indices*/> servers_by_port;
-static std::unordered_map<int /*lfd*/,  int /*port*/>      port_by_listener_fd;
+// vom Master gebundene Listener (port -> lfd), werden an geforkte Worker vererbt
+static std::unordered_map<int, int> inherited_listeners;
+
+static volatile sig_atomic_t g_stop = 0;
+
+Server::Server(int id, bool reuseport) : worker_id(id), reuse_port(reuseport) {}
 
 // sets NONBLOCKING Flag -> systemcalls dont block on fd -> insta retrun
 int make_nonblocking(int fd)
@@ -28,23 +37,51 @@ int make_nonblocking(int fd)
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
-static void reset_for_next_request(Client& c)
+static long monotonic_ms()
+{
+    using clock_t = std::chrono::steady_clock;
+    using ms      = std::chrono::milliseconds;
+    return std::chrono::duration_cast<ms>(clock_t::now().time_since_epoch()).count();
+}
+
+static bool tx_pending(const Client& c)
+{
+    return !c.txq.empty();
+}
+
+// nach peer_eof kein IO_READ mehr: poll meldet den halb geschlossenen Socket
+// sonst in jeder Runde als lesbar (CGI/txq laufen ueber Timer und IO_WRITE weiter)
+static unsigned client_events(const Client& c)
+{
+    unsigned ev = 0;
+    if (!c.peer_eof) ev |= IO_READ;
+    if (c.writing)   ev |= IO_WRITE;
+    return ev;
+}
+
+// Parser-Zustand fuer den naechsten Request; rx (evtl. schon gepipelinte
+// Folge-Requests) und txq (noch nicht gesendete Antworten) bleiben stehen
+static void reset_request_state(Client& c)
 {
-    c.tx.clear();
-    c.rx.clear();
     c.state = RxState::READING_HEADERS;
     c.header_done = false;
     c.is_chunked = false;
     c.content_len = 0;
     c.body_rcvd = 0;
-    c.ch_state = Client::ChunkState::SIZE;
+    c.ch_state = ChunkState::SIZE;
     c.ch_need  = 0;
+    c.scan_pos = 0;
+    c.body_start = 0;
+    c.req.reset();
+    c.arena.reset();
+    c.loc = nullptr;
 }
 
 // opens non-blocking Socket
-static int add_listener(uint16_t port)
+static int open_listener(uint16_t port, bool reuse_port)
 {
-    int s = ::socket(AF_INET, SOCK_STREAM, 0);
+    // CLOEXEC: vorgestartete CGI-Worker sollen weder Listener noch Clients erben
+    int s = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (s < 0)
         return -1;
 
@@ -54,6 +91,15 @@ static int add_listener(uint16_t port)
         ::close(s);
         return -1;
     }
+#ifdef SO_REUSEPORT
+    // jeder Worker bindet seinen eigenen Socket, der Kernel verteilt die Verbindungen
+    if (reuse_port && ::setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) < 0)
+    {
+        perror("setsockopt(SO_REUSEPORT)");
+        ::close(s);
+        return -1;
+    }
+#endif
 
     sockaddr_in a{};
     a.sin_family      = AF_INET;
@@ -79,16 +125,36 @@ static int add_listener(uint16_t port)
         return -1;
     }
 
-    pollfd p{};
-    p.fd = s;
-    p.events = POLLIN;
-    p.revents = 0;
+    return s;
+}
+
+// Listener fuer diesen Worker: vom Master geerbt oder selbst gebunden
+int Server::addListener(uint16_t port)
+{
+    unsigned events = IO_READ;
+    int s;
+    std::unordered_map<int, int>::const_iterator it = inherited_listeners.find(port);
+    if (it != inherited_listeners.end())
+    {
+        s = it->second;
+        events |= IO_EXCLUSIVE;  // alle Worker warten auf denselben Socket
+    }
+    else
+    {
+        s = open_listener(port, reuse_port);
+        if (s < 0)
+            return -1;
+    }
 
-    fds.push_back(p);
-    clients.push_back(Client{}); // Index-Sync
+    if (!reactor->add(s, events))
+    {
+        ::close(s);
+        return -1;
+    }
     listener_fds.insert(s);
 
-    std::cout << "Listening on 0.0.0.0:" << port << "\n";
+    if (worker_id == 0 && it == inherited_listeners.end())
+        std::cout << "Listening on 0.0.0.0:" << port << "\n";
     return s;
 }
 
@@ -146,6 +212,7 @@ static void setupBuiltinDefaultConfig()
 
     g_cfg.servers.clear();
     g_cfg.servers.push_back(srv);
+    g_cfg.finalize();
 }
 
 void Server::loadConfig(int argc, char* argv[])
@@ -205,59 +272,124 @@ void Server::setupListeners()
 
         if (lfd_by_port.find(port) == lfd_by_port.end())
         {
-            int lfd = add_listener(port);
+            int lfd = addListener(port);
             lfd_by_port[port] = lfd;
             port_by_listener_fd[lfd] = port;
             #ifdef DEBUG
             std::cout << "Listening on *:" << port << " (lfd=" << lfd << ")\n";
             #endif
         }
-        servers_by_port[port].push_back(s);
+        vhosts[port].add(s, sc);
     }
 }
 
-void Server::closeClient(size_t &i)
+void Server::closeClient(int fd)
 {
-    ::close(fds[i].fd);
-    fds.erase(fds.begin() + i);
-    clients.erase(clients.begin() + i);
-    --i;
+    Client* c = clients.get(fd);
+    if (c && c->cgi)
+        abortCgi(*c);
+    reactor->remove(fd);
+    ::close(fd);
+    clients.close(fd);
 }
 
-void Server::handleTimeouts(long now_ms, long IDLE_MS)
+// welche Frist gerade gilt, haengt von der Phase der Verbindung ab
+static long client_deadline(const Client& c, const char** phase)
 {
-    for (size_t i = 0; i < fds.size(); ++i)
+    if (tx_pending(c))
     {
-            if (listener_fds.count(fds[i].fd)) continue;
+        *phase = "send";
+        return c.last_active_ms + static_cast<long>(g_cfg.send_timeout_ms);
+    }
+    if (c.cgi)
+    {
+        // wie frueher: keepalive_timeout ohne Ausgabe/Eingabe des Scripts
+        *phase = "cgi";
+        return c.last_active_ms + static_cast<long>(g_cfg.keepalive_timeout_ms);
+    }
+    if (c.state == RxState::READING_BODY)
+    {
+        *phase = "body";
+        return c.last_active_ms + static_cast<long>(g_cfg.body_timeout_ms);
+    }
+    if (!c.rx.empty())
+    {
+        *phase = "header";
+        return c.last_active_ms + static_cast<long>(g_cfg.header_timeout_ms);
+    }
+    *phase = "keepalive";
+    return c.last_active_ms + static_cast<long>(g_cfg.keepalive_timeout_ms);
+}
 
-            if (!clients[i].tx.empty()) continue;
+// nach jeder Aktivitaet: nur wenn die neue Deadline frueher liegt als der
+// scharfe Eintrag, kommt ein neuer in den Heap (sonst wird beim Ablaufen nachgereiht)
+void Server::touchClient(int fd, Client& c)
+{
+    const char* phase;
+    long deadline = client_deadline(c, &phase);
+    if (c.timer_ms == 0 || deadline < c.timer_ms)
+    {
+        timers.push(deadline, clients.handle(fd));
+        c.timer_ms = deadline;
+    }
+}
 
-            if (now_ms - clients[i].last_active_ms > IDLE_MS)
-            {
-                std::cerr << "[TIMEOUT] fd=" << fds[i].fd
-                        << " idle=" << (now_ms - clients[i].last_active_ms) << "ms\n";
-                closeClient(i);
-            }
+// nur faellige Eintraege anfassen, nicht alle Verbindungen
+void Server::handleTimeouts(long now_ms)
+{
+    while (!timers.empty() && timers.top().deadline_ms <= now_ms)
+    {
+        TimerEntry e = timers.top();
+        timers.pop();
+
+        Client* c = clients.get(e.conn);
+        if (!c || c->timer_ms != e.deadline_ms)
+            continue;  // geschlossen/fd neu vergeben oder veralteter Eintrag
+        c->timer_ms = 0;
+
+        const char* phase;
+        long deadline = client_deadline(*c, &phase);
+        if (deadline > now_ms)
+        {
+            timers.push(deadline, e.conn);
+            c->timer_ms = deadline;
+            continue;
+        }
+
+        std::cerr << "[TIMEOUT] fd=" << e.conn.fd << " phase=" << phase
+                << " idle=" << (now_ms - c->last_active_ms) << "ms\n";
+        if (c->cgi && !c->cgi->streaming)
+        {
+            // Script haengt -> abbrechen, Client bekommt 504
+            abortCgi(*c);
+            CGIHandler cgi;
+            Response res = cgi.createErrorResponse(CGI_TIMEOUT);
+            queueResponse(*c, res);
+            handleClientWrite(e.conn.fd, now_ms);
+            continue;
         }
+        closeClient(e.conn.fd);
+    }
 }
 
 // accepts new TCP-connections and makes them non blocking
-void Server::handleListenerEvent(size_t index, long now_ms)
+void Server::handleListenerEvent(int fd, long now_ms)
 {
-    int fd = fds[index].fd;
-
     while (1)
     {
-        int cfd = accept(fd, NULL, NULL);
+        int cfd = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
         if (cfd < 0)
         {
             break;
         }
         make_nonblocking(cfd);
-        pollfd cp{}; cp.fd = cfd; cp.events = POLLIN; cp.revents = 0;
-        fds.push_back(cp);
+        if (!reactor->add(cfd, IO_READ))
+        {
+            ::close(cfd);
+            continue;
+        }
 
-        Client c;
+        Client& c = *clients.open(cfd);
         c.last_active_ms = now_ms;
 
 
@@ -265,12 +397,12 @@ void Server::handleListenerEvent(size_t index, long now_ms)
         c.listen_port = port;
 
         // Default-Server
-        c.server_idx = servers_by_port[port].front();
+        c.server_idx = vhosts[port].defaultServer();
 
         // Body-Limit erstmal mit Server-Default belegen
         const ServerConfig& sc0 = g_cfg.servers[c.server_idx];
         c.max_body_bytes = sc0.client_max_body_size;
-        clients.push_back(c);
+        touchClient(cfd, c);
 
         std::cout << "New client " << cfd << " via port " << port << " -> server#" << c.server_idx << "\n";
     }
@@ -278,273 +410,1025 @@ void Server::handleListenerEvent(size_t index, long now_ms)
 
 static const LocationConfig& resolve_location(const ServerConfig& sc, const std::string& path)
 {
-    size_t best = 0, best_len = 0;
-    for (size_t j = 0; j < sc.locations.size(); ++j)
+    return sc.locations[sc.routes.match(path)];
+}
+
+// read -> req header + body -> response
+// liest bis EAGAIN (noetig fuer edge-triggered epoll), danach wird geparst
+bool Server::handleClientRead(int fd, long now_ms, char* buf, size_t buf_size)
+{
+    Client &c = *clients.get(fd);
+
+    while (!c.peer_eof)
     {
-        const std::string& p = sc.locations[j].path;
-        if (!p.empty() && path.compare(0, p.size(), p) == 0 && p.size() > best_len)
+        ssize_t n = ::read(fd, buf, buf_size);
+        if (n > 0)
         {
-            best = j;
-            best_len = p.size();
+            c.last_active_ms = now_ms;
+            c.rx.append(buf, n);
+            continue;
         }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n < 0 && errno == EINTR)
+            continue;
+        // n == 0 -> Peer hat (mind. die Schreibseite) zugemacht; schon empfangene
+        // Requests (z.B. gepipelint + shutdown) werden noch beantwortet
+        if (n == 0 && (!c.rx.empty() || tx_pending(c) || c.cgi))
+        {
+            c.peer_eof = true;
+            reactor->modify(fd, client_events(c));
+            break;
+        }
+        // n < 0 -> Fehler
+        closeClient(fd);
+        return false;
     }
-    if (best_len == 0)
+
+    processRequest(fd, c, now_ms);
+    // direkt schreiben statt auf IO_WRITE zu warten: der Socket ist fast immer frei
+    if (tx_pending(c))
+        return handleClientWrite(fd, now_ms);
+    if (c.peer_eof && !c.cgi)
     {
-        for (size_t j = 0; j < sc.locations.size(); ++j)
-            if (sc.locations[j].path == "/") return sc.locations[j];
-        return sc.locations.front();
+        closeClient(fd);    // Rest in rx ist kein vollstaendiger Request mehr
+        return false;
     }
-    return sc.locations[best];
-};
+    touchClient(fd, c);
+    return true;
+}
 
-// read -> req header + body -> response
-bool Server::handleClientRead(size_t &i, long now_ms, char* buf, size_t buf_size)
+// Header und Body bleiben getrennte Segmente; der Body wird verschoben (oder aus dem
+// content_cache geteilt), nicht kopiert. Der Header-Block nutzt einen alten Sendepuffer
+void Server::queueResponse(Client& c, Response& res)
 {
-    ssize_t n = ::read(fds[i].fd, buf, buf_size);
-
-    if (n > 0)
+    std::string head = c.txq.buffer();
+    res.headerBlock(head);
+    c.txq.pushData(std::move(head));
+    for (size_t i = 0; i < res.file_parts.size(); ++i)
     {
-        Client &c = clients[i];
-        c.last_active_ms = now_ms;
-        c.rx.append(buf, n);
+        c.txq.pushData(std::move(res.file_parts[i].head));
+        c.txq.pushFile(res.file, res.file_parts[i].off, res.file_parts[i].len);
+    }
+    if (res.body_ref)
+        c.txq.pushShared(res.body_ref);
+    else
+        c.txq.pushData(std::move(res.body));
+    if (res.file && res.file_parts.empty())
+        c.txq.pushFile(res.file, res.file_offset, res.file_length);
+    c.txq.endResponse();
+    ++c.inflight;
+    if (!res.keep_alive)
+        c.close_after = true;   // keine weiteren Requests mehr parsen
+    std::cout << "[STATUS CODE] " << res.statusCode << std::endl;
+}
 
-        size_t headerEnd = c.rx.find("\r\n\r\n");
-        if (headerEnd == std::string::npos)
-            return true;
+// Fehlerantwort; das Framing ist danach unklar -> Verbindung wird geschlossen
+void Server::rejectRequest(Client& c, int code, const std::string& html)
+{
+    ResponseHandler handler;
+    Response res = handler.makeHtmlResponse(code, html);
 
-        std::string headers = c.rx.substr(0, headerEnd + 4);
+    res.keep_alive = false;
+    c.keep_alive   = false;
 
-        RequestParser parser;
-        Request req;
-        if (!parser.parseHeaders(headers, req))
-        {
-            ResponseHandler handler;
-            Response res = handler.makeHtmlResponse(400, "<h1>400 Bad Request</h1>");
-            c.tx = res.toString();
-            fds[i].events |= POLLOUT;
-            std::cout << "[STATUS CODE] " << res.statusCode << std::endl;
-            return true;
-        }
+    c.rx.clear();
+    queueResponse(c, res);
+}
+
+static size_t max_body_for(const ServerConfig& sc, const LocationConfig& lc)
+{
+    // Größenprüfung mit Location/Server-Konfiguration
+    return (lc.client_max_body_size > 0) ? lc.client_max_body_size
+                                         : sc.client_max_body_size;
+}
+
+// Header genau einmal parsen (direkt aus rx), vHost + Location aufloesen,
+// Body-Framing festlegen. false = Fehlerantwort ist schon eingereiht.
+bool Server::beginRequest(Client& c, size_t header_end)
+{
+    RequestParser parser;
+    Request& req = c.req;
 
-        if (req.version == "HTTP/1.1")
+    if (!parser.parseHeaders(std::string_view(c.rx).substr(0, header_end + 2), req))
+    {
+        rejectRequest(c, 400, "<h1>400 Bad Request</h1>");
+        return false;
+    }
+
+    if (req.version == "HTTP/1.1")
+    {
+        if (req.headers.get(H_HOST).empty())
         {
-            if (req.headers.find("Host") == req.headers.end() || req.headers["Host"].empty())
-            {
-                ResponseHandler handler;
-                Response res = handler.makeHtmlResponse(400,
-                    "<h1>400 Bad Request</h1><p>HTTP/1.1 requests must include a Host header</p>");
-                c.tx = res.toString();
-                fds[i].events |= POLLOUT;
-                std::cout << "[STATUS CODE] " << res.statusCode << std::endl;
-                return true;
-            }
+            rejectRequest(c, 400,
+                "<h1>400 Bad Request</h1><p>HTTP/1.1 requests must include a Host header</p>");
+            return false;
         }
+    }
 
-        // Connection handling
-        if (req.version == "HTTP/1.1")
-            req.keep_alive = !(req.headers.count("Connection") &&
-                              req.headers["Connection"] == "close");
-        else if (req.version == "HTTP/1.0")
-            req.keep_alive = (req.headers.count("Connection") &&
-                             req.headers["Connection"] == "keep-alive");
+    // vHost bestimmen; gleicher Host wie beim letzten Request -> Ergebnis behalten
+    std::string_view host = req.headers.get(H_HOST);
+    if (!c.host_known || host != c.host)
+    {
+        c.host = host;
+        c.server_idx = vhosts[c.listen_port].find(c.host);
+        c.host_known = true;
+    }
+    const ServerConfig& sc = g_cfg.servers[c.server_idx];
+    c.loc = &resolve_location(sc, req.path);
+
+    // 413 schon vor dem Body, wenn Content-Length zu gross ist
+    if (!parser.prepareBody(req, max_body_for(sc, *c.loc)))
+    {
+        rejectRequest(c, 413, "<h1>413 Payload Too Large</h1>");
+        return false;
+    }
 
-        // vHost bestimmen
-        int port = c.listen_port;
-        size_t server_idx = servers_by_port[port].front();
-        std::string host = req.headers["Host"];
+    c.header_done = true;
+    c.is_chunked  = req.is_chunked;
+    c.content_len = req.content_len;
+    c.body_start  = header_end + 4;
+    c.scan_pos    = c.body_start;
+    c.state       = RxState::READING_BODY;
+    return true;
+}
 
-        if (!host.empty() && servers_by_port.count(port))
+// einen Request aus rx weiterparsen; setzt dort fort, wo der letzte Aufruf
+// aufgehoert hat, statt rx jedes Mal von vorne zu durchsuchen.
+// true = Antwort eingereiht, rx beginnt jetzt mit dem naechsten Request
+bool Server::parseRequest(int fd, Client& c, long now_ms)
+{
+    if (!c.header_done)
+    {
+        // 3 Bytes zurueck, falls "\r\n\r\n" ueber zwei Reads verteilt ankam
+        size_t from = (c.scan_pos > 3) ? c.scan_pos - 3 : 0;
+        size_t headerEnd = c.rx.find("\r\n\r\n", from);
+        if (headerEnd == std::string::npos || headerEnd + 4 > c.max_header_bytes)
         {
-            size_t colon = host.find(':');
-            if (colon != std::string::npos) host = host.substr(0, colon);
+            c.scan_pos = c.rx.size();
+            if (c.rx.size() > c.max_header_bytes)
+                rejectRequest(c, 431, "<h1>431 Request Header Fields Too Large</h1>");
+            return false;
+        }
+        if (!beginRequest(c, headerEnd))
+            return false;
+    }
 
-            for (size_t idx : servers_by_port[port])
-            {
-                if (g_cfg.servers[idx].server_name == host)
-                {
-                    server_idx = idx;
-                    break;
-                }
-            }
+    const ServerConfig& sc = g_cfg.servers[c.server_idx];
+    const LocationConfig& lc = *c.loc;
+    Request& req = c.req;
+    size_t totalNeeded = c.body_start;
+
+    if (c.is_chunked)
+    {
+        // dekodierte Bytes wandern sofort nach req.body, rx behaelt nur den unvollstaendigen Rest
+        RequestParser parser;
+        size_t used = 0;
+        std::string_view raw = std::string_view(c.rx).substr(c.body_start);
+        if (!parser.decodeChunks(raw, used, c.ch_state, c.ch_need, req, max_body_for(sc, lc)))
+        {
+            int code = (req.error != 0) ? req.error : 400;
+            rejectRequest(c, code,
+                (code == 413)
+                    ? "<h1>413 Payload Too Large</h1>"
+                    : "<h1>400 Bad Request</h1>");
+            return false;
         }
+        c.rx.erase(c.body_start, used);
+        c.body_rcvd = req.body.size();
+        if (c.ch_state != ChunkState::DONE)
+            return false;
+    }
+    else
+    {
+        totalNeeded += c.content_len;
+        c.body_rcvd = std::min(c.rx.size() - c.body_start, c.content_len);
+        if (c.rx.size() < totalNeeded)
+            return false;
+        req.body.assign(c.rx, c.body_start, c.content_len);
+    }
+
+    #ifdef DEBUG
+    std::cout << "[SERVER] Parsed request body: '" << req.body << "'" << std::endl;
+    std::cout << "[SERVER] Body size: " << req.body.size() << std::endl;
+    #endif
+
+    c.state  = RxState::READY;
+    c.target = req.path;
 
-        c.server_idx = server_idx;
-        const ServerConfig& sc = g_cfg.servers[server_idx];
+    c.rx.erase(0, totalNeeded);
 
-        const LocationConfig& lc = resolve_location(sc, req.path);
+    req.conn_fd = fd;
 
-        bool isChunked = req.headers.count("Transfer-Encoding") &&
-                        req.headers["Transfer-Encoding"] == "chunked";
+    ResponseHandler handler;
+    Response res = handler.handleRequest(req, lc, sc);
 
-        size_t contentLength = 0;
-        if (!isChunked && req.headers.count("Content-Length"))
+    c.last_active_ms = now_ms;
+    if (res.cgi)
+        startCgi(fd, c, res.cgi);   // Antwort kommt, wenn das Script fertig ist
+    else
+    {
+        c.keep_alive = res.keep_alive;
+        queueResponse(c, res);
+    }
+    reset_request_state(c);
+    return true;
+}
+
+// alle vollstaendigen Requests aus rx beantworten, bis zur pipeline_depth;
+// die Antworten landen der Reihe nach in derselben TxQueue
+void Server::processRequest(int fd, Client& c, long now_ms)
+{
+    while (!c.close_after && !c.cgi && c.inflight < g_cfg.pipeline_depth && !c.rx.empty())
+    {
+        if (!parseRequest(fd, c, now_ms))
+            break;
+    }
+}
+
+// send resposnse -> keep alive or close
+// schreibt bis EAGAIN oder bis die TxQueue leer ist; wenn die Pipeline voll
+// war, werden die in rx wartenden Requests danach gleich nachgezogen
+bool Server::handleClientWrite(int fd, long now_ms)
+{
+    Client &c = *clients.get(fd);
+
+    while (tx_pending(c))
+    {
+        size_t sent = 0;
+        TxQueue::Result r = c.txq.flush(fd, sent);
+        if (sent > 0)
+            c.last_active_ms = now_ms;
+        c.inflight -= c.txq.takeCompleted();
+        if (c.cgi && c.cgi->paused)
+            resumeCgi(c);
+
+        if (r == TxQueue::TX_ERROR)
+        {
+            closeClient(fd);
+            return false;
+        }
+        if (r == TxQueue::TX_AGAIN)
         {
-            try
+            if (!c.writing)
             {
-                contentLength = std::stoul(req.headers["Content-Length"]);
+                c.writing = true;
+                reactor->modify(fd, client_events(c));
             }
-            catch (...) {}
+            touchClient(fd, c);
+            return true;
+        }
+        if (c.close_after)
+        {
+            closeClient(fd);
+            return false;
+        }
+        processRequest(fd, c, now_ms);
+    }
 
-            // Größenprüfung mit Location/Server-Konfiguration
-            size_t maxBody = (lc.client_max_body_size > 0)
-                            ? lc.client_max_body_size
-                            : sc.client_max_body_size;
+    if (c.peer_eof && !c.cgi)
+    {
+        closeClient(fd);
+        return false;
+    }
+    if (c.writing)
+    {
+        c.writing = false;
+        reactor->modify(fd, client_events(c));  // nicht mehr schreiben
+    }
+    touchClient(fd, c);
+    return true;
+}
 
-            if (maxBody > 0 && contentLength > maxBody)
-            {
-                ResponseHandler handler;
-                Response res = handler.makeHtmlResponse(413, "<h1>413 Payload Too Large</h1>");
+// ===== CGI im Reactor =====
+static const size_t CGI_STREAM_MIN   = 16 * 1024;   // so viel gepuffert -> sofort streamen
+static const long   CGI_STREAM_DELAY = 50;          // ms nach dem Header-Block
+static const size_t CGI_TX_HIGH      = 256 * 1024;  // Client-Puffer voll -> stdout-Pipe pausieren
+static const size_t CGI_TX_LOW       = 64 * 1024;   // wieder lesen
 
-                res.keep_alive = false;
-                c.keep_alive   = false;
+// Das Script laeuft, waehrend der Worker andere Clients bedient: Body geht
+// ueber die stdin-Pipe rein, stdout wird gesammelt, und der Exit-Status
+// wird mit waitpid(WNOHANG) abgeholt (kein SIGCHLD-Handler, der bei
+// mehreren Worker-Threads Kinder der anderen abgreifen wuerde).
 
-                c.tx = res.toString();
-                fds[i].events |=  POLLOUT;
+void Server::startCgi(int fd, Client& c, const std::shared_ptr<CgiJob>& job)
+{
+    if (!job->fastcgi.empty())
+    {
+        startFastCgi(fd, c, job);
+        return;
+    }
+    if (job->pool)
+    {
+        startPooledCgi(fd, c, job);
+        return;
+    }
+
+    ConnHandle h = clients.handle(fd);
+    job->input.swap(c.req.body);   // Body nicht kopieren
+    job->keep_alive = c.req.keep_alive;
+    job->http11 = (c.req.version == "HTTP/1.1");
+    c.cgi = job;
+
+    if (!reactor->add(job->out_fd, IO_READ))
+    {
+        abortCgi(c);
+        CGIHandler cgi;
+        Response res = cgi.createErrorResponse(CGI_INTERNAL_ERROR);
+        queueResponse(c, res);
+        return;
+    }
+    cgi_fds[job->out_fd] = h;
+
+    if (job->input.empty() || job->writeInput() == CgiJob::IO_DONE)
+    {
+        ::close(job->in_fd);       // EOF auf stdin
+        job->in_fd = -1;
+    }
+    else if (reactor->add(job->in_fd, IO_WRITE))
+        cgi_fds[job->in_fd] = h;
+    else
+    {
+        ::close(job->in_fd);
+        job->in_fd = -1;
+    }
+}
+
+void Server::dropCgiFd(int& pipe_fd)
+{
+    if (pipe_fd < 0)
+        return;
+    reactor->remove(pipe_fd);
+    cgi_fds.erase(pipe_fd);
+    ::close(pipe_fd);
+    pipe_fd = -1;
+}
+
+void Server::handleCgiEvent(int pipe_fd, long now_ms)
+{
+    ConnHandle h = cgi_fds[pipe_fd];
+    Client* c = clients.get(h);
+    if (!c || !c->cgi)
+    {
+        // sollte nicht passieren: closeClient raeumt die Pipes mit ab
+        reactor->remove(pipe_fd);
+        cgi_fds.erase(pipe_fd);
+        ::close(pipe_fd);
+        return;
+    }
+
+    CgiJob& job = *c->cgi;
+    if (pipe_fd == job.in_fd)
+    {
+        if (job.writeInput() != CgiJob::IO_AGAIN)
+            dropCgiFd(job.in_fd);
+    }
+    else
+    {
+        // beim Streamen nur so viel lesen, wie in den Client-Puffer passt
+        size_t room = std::string::npos;
+        if (job.streaming)
+            room = CGI_TX_HIGH - std::min(CGI_TX_HIGH, c->txq.bytes());
+        if (job.readOutput(room) != CgiJob::IO_AGAIN)
+            dropCgiFd(job.out_fd);
+    }
 
-                c.rx.clear();
-                std::cout << "[STATUS CODE] " << res.statusCode << std::endl;
+    c->last_active_ms = now_ms;
+    if (job.out_fd < 0)
+    {
+        dropCgiFd(job.in_fd);      // Script liest nicht mehr
+        completeCgi(h.fd, *c, now_ms);
+        return;
+    }
+    if (streamCgi(h.fd, *c, now_ms))
+        touchClient(h.fd, *c);
+}
+
+// Ist der Header-Block komplett, geht der Kopf raus, sobald das Script
+// CGI_STREAM_DELAY danach noch laeuft (oder CGI_STREAM_MIN gepuffert hat);
+// wer sofort mit Fehler endet, bekommt so weiterhin eine 500. Danach wird
+// jede neue Ausgabe gleich weitergereicht. false = Client ist zu.
+bool Server::streamCgi(int fd, Client& c, long now_ms)
+{
+    CgiJob& job = *c.cgi;
+    if (!job.streaming)
+    {
+        if (!job.streamable())
+            return true;
+        if (job.head_ms == 0)
+        {
+            Response probe;
+            size_t body_off;
+            size_t content_length;
+            probe.headers.set(H_CONTENT_TYPE, "text/html");
+            if (CGIHandler::parseHead(job.output, probe, body_off, content_length) == CGI_HEAD_MORE)
+                return true;
+            if (job.inject_color && probe.headers.get(H_CONTENT_TYPE) == "text/html")
+            {
+                job.no_stream = true;   // injectUserColor() am Ende
                 return true;
             }
+            job.head_ms = now_ms;
+            cgi_heads.push_back(clients.handle(fd));
         }
+        if (job.output.size() < CGI_STREAM_MIN && now_ms - job.head_ms < CGI_STREAM_DELAY)
+            return true;
+
+        CGIHandler cgi;
+        Response head = cgi.beginStream(job);
+        c.keep_alive = head.keep_alive;
+        c.txq.pushData(head.headerBlock());
+        ++c.inflight;
+        std::cout << "[STATUS CODE] " << head.statusCode << " (streamed)" << std::endl;
+    }
+
+    forwardCgiOutput(c);
+    if (!job.paused && job.out_fd >= 0 && c.txq.bytes() >= CGI_TX_HIGH)
+    {
+        // Client kommt nicht hinterher: Pipe ruhen lassen, das Script blockiert
+        // dann im write(); handleClientWrite meldet sie wieder an
+        reactor->remove(job.out_fd);
+        job.paused = true;
+    }
+    return handleClientWrite(fd, now_ms);
+}
+
+// last: Script ist fertig -> gzip-Strom abschliessen
+void Server::forwardCgiOutput(Client& c, bool last)
+{
+    CgiJob& job = *c.cgi;
+    if (job.stream_left != std::string::npos)
+    {
+        // mehr als angekuendigt wird verworfen
+        if (job.output.size() > job.stream_left)
+            job.output.resize(job.stream_left);
+        job.stream_left -= job.output.size();
+    }
+    if (job.deflater && (!job.output.empty() || last))
+    {
+        std::string z;
+        job.deflater->push(job.output.data(), job.output.size(), z, last);
+        job.output.swap(z);
+    }
+    if (job.output.empty())
+        return;
+    if (job.chunked)
+    {
+        char size[32];
+        std::snprintf(size, sizeof(size), "%zx\r\n", job.output.size());
+        c.txq.pushData(size);
+        c.txq.pushData(std::move(job.output));
+        c.txq.pushData("\r\n");
+    }
+    else
+        c.txq.pushData(std::move(job.output));
+    job.output.clear();
+}
+
+void Server::resumeCgi(Client& c)
+{
+    CgiJob& job = *c.cgi;
+    if (c.txq.bytes() >= CGI_TX_LOW || job.out_fd < 0)
+        return;
+    job.paused = false;
+    if (!reactor->add(job.out_fd, IO_READ))   // meldet gleich, was in der Pipe liegt
+        dropCgiFd(job.out_fd);
+}
 
-        size_t totalNeeded = headerEnd + 4;
-        size_t bodyStart = headerEnd + 4;
+// Script ist fertig, Kopf war schon raus: Rest + Ende. Ging etwas schief,
+// laesst sich der Status nicht mehr aendern -> ohne Abschluss schliessen,
+// damit der Client die Antwort als unvollstaendig erkennt.
+void Server::endCgiStream(int fd, Client& c, long now_ms)
+{
+    CgiJob& job = *c.cgi;
+    bool ok = job.error == CGI_SUCCESS && WIFEXITED(job.status) && WEXITSTATUS(job.status) == 0;
+    if (!ok)
+        std::cerr << "CGI failed after its response was sent, closing connection" << std::endl;
+
+    forwardCgiOutput(c, ok);
+    // mit gzip ist auch eine Script-Laenge nur noch Kontrolle, gesendet wird chunked
+    bool complete = ok && (job.stream_left != std::string::npos ? job.stream_left == 0 : job.chunked);
+    if (complete && job.chunked)
+        c.txq.pushData("0\r\n\r\n");
+    if (!complete || !job.keep_alive)
+        c.close_after = true;
+    c.cgi.reset();
+
+    if (!c.txq.empty())
+    {
+        c.txq.endResponse();
+        handleClientWrite(fd, now_ms);
+        return;
+    }
+    --c.inflight;   // alles war schon beim Client
+    if (c.close_after)
+    {
+        closeClient(fd);
+        return;
+    }
+    processRequest(fd, c, now_ms);
+    handleClientWrite(fd, now_ms);
+}
 
-        if (isChunked)
+// stdout ist zu; Antwort gibt es, sobald der Exit-Status da ist
+void Server::completeCgi(int fd, Client& c, long now_ms)
+{
+    if (c.cgi->reap())
+    {
+        finishCgi(fd, c, now_ms);
+        return;
+    }
+    cgi_waiting.push_back(clients.handle(fd));
+    touchClient(fd, c);
+}
+
+void Server::finishCgi(int fd, Client& c, long now_ms)
+{
+    if (c.cgi->streaming)
+    {
+        endCgiStream(fd, c, now_ms);
+        return;
+    }
+    CGIHandler cgi;
+    Response res = cgi.finish(*c.cgi);
+    if (c.cgi->inject_color)
+        ResponseHandler::injectUserColor(res, c.cgi->color);
+    if (c.cgi->gzip)
+        compressResponse(res, *c.cgi->gzip, c.cgi->encoding);
+    c.cgi.reset();
+
+    c.keep_alive = res.keep_alive;
+    queueResponse(c, res);
+    handleClientWrite(fd, now_ms);
+}
+
+// Client weg oder Timeout: Pipes zu, Prozess killen und spaeter abholen
+void Server::abortCgi(Client& c)
+{
+    CgiJob& job = *c.cgi;
+    if (!job.fastcgi.empty())
+    {
+        // FCGI_ABORT_REQUEST geht mit dem naechsten IO_WRITE raus
+        std::vector<std::unique_ptr<FcgiConn> >& pool = fcgi_pool[job.fastcgi];
+        for (size_t i = 0; i < pool.size(); ++i)
         {
-            size_t endMarker = c.rx.find("0\r\n\r\n", bodyStart);
-            if (endMarker == std::string::npos)
-                return true;
-            totalNeeded = endMarker + 5;
+            if (!pool[i]->abort(&job))
+                continue;
+            if (!pool[i]->writing)
+            {
+                reactor->modify(pool[i]->fd(), IO_READ | IO_WRITE);
+                pool[i]->writing = true;
+            }
+            break;
         }
-        else
+        c.cgi.reset();
+        return;
+    }
+    if (job.pool)
+    {
+        // laeuft das Script schon, wird der Worker geopfert und ersetzt
+        CgiPool& pool = cgiPoolFor(*job.pool);
+        CgiPool::Worker* w = pool.find(&job);
+        if (w)
+            retirePoolWorker(pool, w, true);
+        for (std::deque<CgiPool::Pending>::iterator it = pool.queue.begin(); it != pool.queue.end(); ++it)
         {
-            totalNeeded += contentLength;
-            if (c.rx.size() < totalNeeded)
-                return true;
+            if (it->job.get() == &job)
+            {
+                pool.queue.erase(it);
+                break;
+            }
         }
+        c.cgi.reset();
+        runPool(pool, monotonic_ms());
+        return;
+    }
+    dropCgiFd(job.in_fd);
+    dropCgiFd(job.out_fd);
+    if (!job.exited)
+    {
+        ::kill(job.pid, SIGKILL);
+        cgi_orphans.push_back(job.pid);
+    }
+    c.cgi.reset();
+}
 
-        std::string fullRequest = c.rx.substr(0, totalNeeded);
-        std::istringstream stream(fullRequest);
-
-        // Skip Headers
-        std::string line;
-        while (std::getline(stream, line))
+void Server::reapCgi(long now_ms)
+{
+    for (size_t i = 0; i < cgi_waiting.size(); )
+    {
+        ConnHandle h = cgi_waiting[i];
+        Client* c = clients.get(h);
+        if (c && c->cgi && c->cgi->out_fd < 0 && !c->cgi->reap())
         {
-            if (!line.empty() && line.back() == '\r')
-                line.pop_back();
-            if (line.empty())
-                break;
+            ++i;
+            continue;
         }
+        cgi_waiting[i] = cgi_waiting.back();
+        cgi_waiting.pop_back();
+        if (c && c->cgi && c->cgi->out_fd < 0)
+            finishCgi(h.fd, *c, now_ms);
+    }
 
+    // Header-Block da und Script laeuft noch -> jetzt streamen
+    for (size_t i = 0; i < cgi_heads.size(); )
+    {
+        ConnHandle h = cgi_heads[i];
+        Client* c = clients.get(h);
+        bool live = c && c->cgi && c->cgi->head_ms && !c->cgi->streaming && c->cgi->out_fd >= 0;
+        if (live && now_ms - c->cgi->head_ms < CGI_STREAM_DELAY)
+        {
+            ++i;
+            continue;
+        }
+        cgi_heads[i] = cgi_heads.back();
+        cgi_heads.pop_back();
+        if (live)
+            streamCgi(h.fd, *c, now_ms);
+    }
 
-        if (!parser.parseBody(stream, req, lc, sc))
+    for (size_t i = 0; i < cgi_orphans.size(); )
+    {
+        pid_t r = ::waitpid(cgi_orphans[i], NULL, WNOHANG);
+        if (r == 0 || (r < 0 && errno == EINTR))
         {
-            int code = (req.error != 0) ? req.error : 400;
+            ++i;
+            continue;
+        }
+        cgi_orphans[i] = cgi_orphans.back();
+        cgi_orphans.pop_back();
+    }
+}
 
-            ResponseHandler handler;
-            Response res = handler.makeHtmlResponse(code,
-                (code == 413)
-                    ? "<h1>413 Payload Too Large</h1>"
-                    : "<h1>400 Bad Request</h1>");
+// ===== FastCGI =====
+static const size_t FCGI_MAX_IDLE = 8;   // offene, unbenutzte Verbindungen pro Backend
 
-            res.keep_alive = false;
-            c.keep_alive = false;
+// Verbindungen pro Backend-Adresse bleiben offen (FCGI_KEEP_CONN) und werden
+// wiederverwendet; mit "multiplex" laufen alle Requests ueber eine.
 
-            c.tx = res.toString();
-            fds[i].events |= POLLOUT;
+void Server::startFastCgi(int fd, Client& c, const std::shared_ptr<CgiJob>& job)
+{
+    job->input.swap(c.req.body);
+    c.cgi = job;
 
-            c.rx.clear();
-            std::cout << "[STATUS CODE] " << res.statusCode << std::endl;
-            return true;
-        }
+    FcgiConn* conn = fcgiConnFor(*job);
+    if (!conn)
+    {
+        c.cgi.reset();
+        CGIHandler cgi;
+        Response res = cgi.createErrorResponse(CGI_UPSTREAM_ERROR);
+        queueResponse(c, res);
+        return;
+    }
+    conn->submit(job, clients.handle(fd));
+    if (!flushFcgi(conn))
+    {
+        // Backend hat die Verbindung inzwischen zugemacht: nicht hier mitten im
+        // Parsen abraeumen; MOD laesst den Reactor den Fehler gleich melden
+        reactor->modify(conn->fd(), IO_READ | IO_WRITE);
+        conn->writing = true;
+    }
+}
 
-        #ifdef DEBUG
-        std::cout << "[SERVER] Parsed request body: '" << req.body << "'" << std::endl;
-        std::cout << "[SERVER] Body size: " << req.body.size() << std::endl;
-        #endif
+FcgiConn* Server::fcgiConnFor(const CgiJob& job)
+{
+    std::vector<std::unique_ptr<FcgiConn> >& pool = fcgi_pool[job.fastcgi];
+    for (size_t i = 0; i < pool.size(); ++i)
+    {
+        if (pool[i]->accepts())
+            return pool[i].get();
+    }
 
-        c.state  = RxState::READY;
-        c.target = req.path;
+    std::unique_ptr<FcgiConn> conn(new FcgiConn(job.fastcgi, job.fastcgi_mpx));
+    if (!conn->connect() || !reactor->add(conn->fd(), IO_READ | IO_WRITE))
+        return NULL;
+    conn->writing = true;
+    fcgi_fds[conn->fd()] = conn.get();
+    pool.push_back(std::move(conn));
+    return pool.back().get();
+}
 
-        c.rx.erase(0, totalNeeded);
+// sofort schreiben, wenn verbunden; IO_WRITE nur solange noch etwas offen ist
+bool Server::flushFcgi(FcgiConn* conn)
+{
+    if (conn->ready() && !conn->onWritable())
+        return false;
+    bool w = conn->wantsWrite();
+    if (w != conn->writing)
+    {
+        reactor->modify(conn->fd(), w ? (IO_READ | IO_WRITE) : IO_READ);
+        conn->writing = w;
+    }
+    return true;
+}
 
-        if (c.state == RxState::READY && c.tx.empty())
+void Server::handleFcgiEvent(int sock, unsigned events, long now_ms)
+{
+    FcgiConn* conn = fcgi_fds[sock];
+    std::vector<FcgiConn::Slot> done;
+
+    bool ok = !(events & IO_ERROR) || conn->ready();
+    if (ok && (events & (IO_WRITE | IO_ERROR)))
+        ok = conn->onWritable();
+    if (ok && (events & (IO_READ | IO_ERROR)))
+        ok = conn->onReadable(done);
+    if (ok)
+        ok = flushFcgi(conn);
+
+    if (events & IO_READ)
+    {
+        // Backend liefert -> Requests auf dieser Verbindung sind nicht idle
+        const std::map<uint16_t, FcgiConn::Slot>& act = conn->active();
+        for (std::map<uint16_t, FcgiConn::Slot>::const_iterator it = act.begin(); it != act.end(); ++it)
         {
-            req.conn_fd = fds[i].fd;
+            Client* c = clients.get(it->second.client);
+            if (c && c->cgi == it->second.job)
+            {
+                c->last_active_ms = now_ms;
+                touchClient(it->second.client.fd, *c);
+            }
+        }
+    }
 
-            ResponseHandler handler;
-            Response res = handler.handleRequest(req, lc, sc);
+    if (!ok)
+    {
+        conn->failAll(done);
+        closeFcgiConn(conn);
+    }
+    else if (conn->active().empty() && !conn->wantsWrite())
+    {
+        // nach einer Lastspitze nicht beliebig viele Verbindungen offen halten
+        std::vector<std::unique_ptr<FcgiConn> >& pool = fcgi_pool[conn->address()];
+        size_t idle = 0;
+        for (size_t i = 0; i < pool.size(); ++i)
+            idle += pool[i]->active().empty();
+        if (idle > FCGI_MAX_IDLE)
+            closeFcgiConn(conn);
+    }
 
-            c.last_active_ms = now_ms;
-            c.keep_alive = res.keep_alive;
-            c.tx         = res.toString();
-            fds[i].events |=  POLLOUT;
-            std::cout << "[STATUS CODE] " << res.statusCode << std::endl;
-        }
-        return true;
+    for (size_t i = 0; i < done.size(); ++i)
+    {
+        Client* c = clients.get(done[i].client);
+        if (c && c->cgi == done[i].job)
+            finishCgi(done[i].client.fd, *c, now_ms);
     }
-    if (n == 0)
+}
+
+void Server::closeFcgiConn(FcgiConn* conn)
+{
+    int sock = conn->fd();
+    reactor->remove(sock);
+    fcgi_fds.erase(sock);
+
+    std::vector<std::unique_ptr<FcgiConn> >& pool = fcgi_pool[conn->address()];
+    for (size_t i = 0; i < pool.size(); ++i)
     {
-        closeClient(i);
-        return false;
+        if (pool[i].get() == conn)
+        {
+            pool[i].swap(pool.back());
+            pool.pop_back();   // schliesst den Socket
+            break;
+        }
     }
-    if (n < 0)
+}
+
+// ===== CGI-Pool =====
+// Pro Location mit "cgi_pool" laufen bis zu n Interpreter dauerhaft; ein Job
+// geht an einen freien Worker oder wartet in der Queue des Pools. Beendete
+// Worker landen wie abgebrochene Scripts in cgi_orphans.
+
+void Server::startCgiPools(long now_ms)
+{
+    for (size_t s = 0; s < g_cfg.servers.size(); ++s)
     {
-        closeClient(i);
-        return false;
+        const std::vector<LocationConfig>& locs = g_cfg.servers[s].locations;
+        for (size_t l = 0; l < locs.size(); ++l)
+        {
+            if (locs[l].cgi_pool == 0)
+                continue;
+            CgiPool& pool = cgiPoolFor(locs[l]);
+            while (!pool.full() && spawnPoolWorker(pool, now_ms))
+                ;
+        }
     }
-    return true;
 }
 
-// send resposnse -> keep alive or close
-bool Server::handleClientWrite(size_t &i, long now_ms)
+CgiPool& Server::cgiPoolFor(const LocationConfig& loc)
 {
-    Client &c = clients[i];
+    std::unique_ptr<CgiPool>& pool = cgi_pools[&loc];
+    if (!pool)
+        pool.reset(new CgiPool(loc));
+    return *pool;
+}
 
-    if (c.tx.empty())
+void Server::startPooledCgi(int fd, Client& c, const std::shared_ptr<CgiJob>& job)
+{
+    long now_ms = monotonic_ms();
+    CgiPool& pool = cgiPoolFor(*job->pool);
+    if (pool.workers.empty() && !spawnPoolWorker(pool, now_ms))
     {
-        fds[i].events &= ~POLLOUT;  // nicht mehr schreiben
-        return true;
+        CGIHandler cgi;
+        Response res = cgi.createErrorResponse(CGI_FORK_ERROR);
+        queueResponse(c, res);
+        return;
     }
 
-    ssize_t m = write(fds[i].fd, c.tx.data(), c.tx.size());
+    job->input.swap(c.req.body);
+    c.cgi = job;
+    CgiPool::Pending p;
+    p.job = job;
+    p.client = clients.handle(fd);
+    pool.queue.push_back(p);
+    runPool(pool, now_ms);
+}
 
-    if (m > 0)
+CgiPool::Worker* Server::spawnPoolWorker(CgiPool& pool, long now_ms)
+{
+    CgiPool::Worker* w = pool.spawn(now_ms);
+    if (!w)
+        return NULL;
+    if (!reactor->add(w->sock, IO_READ))
     {
-        c.tx.erase(0, static_cast<size_t>(m));
-        c.last_active_ms = now_ms;
+        cgi_orphans.push_back(pool.retire(w, true));
+        return NULL;
     }
-    if (m == 0)
+    pool_fds[w->sock] = &pool;
+    return w;
+}
+
+// wartende Jobs an freie Worker; fehlt einer, bis zur Poolgroesse nachstarten.
+// Beendet keine Clients, darf also auch mitten aus closeClient kommen.
+void Server::runPool(CgiPool& pool, long now_ms)
+{
+    while (!pool.queue.empty())
     {
-        closeClient(i);
-        return false;
+        CgiPool::Worker* w = pool.idle();
+        if (!w && !pool.full())
+            w = spawnPoolWorker(pool, now_ms);
+        if (!w)
+            break;
+        pool.assign(*w, pool.queue.front());
+        pool.queue.pop_front();
+        flushPoolWorker(*w);
     }
-    if (m < 0)
+}
+
+// wie flushFcgi: Schreibfehler meldet der Reactor gleich als Event
+void Server::flushPoolWorker(CgiPool::Worker& w)
+{
+    bool want = w.woff < w.wbuf.size();
+    if (want && pool_fds[w.sock]->onWritable(w) != CgiJob::IO_AGAIN)
+        want = !w.wbuf.empty();
+    if (want != w.writing)
     {
-        closeClient(i);
-        return false;
+        reactor->modify(w.sock, want ? (IO_READ | IO_WRITE) : IO_READ);
+        w.writing = want;
     }
+}
 
-    if (c.tx.empty())
+void Server::handlePoolEvent(int sock, unsigned events, long now_ms)
+{
+    CgiPool& pool = *pool_fds[sock];
+    CgiPool::Worker* w = pool.find(sock);
+    std::shared_ptr<CgiJob> job = w->job;
+    ConnHandle client = w->client;
+
+    CgiJob::Io r = CgiJob::IO_AGAIN;
+    if (job && (events & (IO_WRITE | IO_ERROR)))
+        r = pool.onWritable(*w) == CgiJob::IO_ERROR ? CgiJob::IO_ERROR : CgiJob::IO_AGAIN;
+    if (r != CgiJob::IO_ERROR && (events & (IO_READ | IO_ERROR)))
+        r = pool.onReadable(*w);
+
+    if (r == CgiJob::IO_ERROR)
     {
-        if (c.keep_alive)
+        if (job)
         {
-            reset_for_next_request(c);
-            fds[i].events &= ~POLLOUT;  // nicht mehr schreiben
-            return true;
+            std::cerr << "cgi_pool worker " << w->pid << " died during a request" << std::endl;
+            job->error = CGI_INTERNAL_ERROR;
+            job->exited = true;
+        }
+        retirePoolWorker(pool, w, false);
+    }
+    else if (r == CgiJob::IO_DONE)
+    {
+        pool.release(*w, now_ms);
+        size_t max = pool.location().cgi_pool_max_requests;
+        if (w->eof || (max && w->served >= max))
+        {
+            retirePoolWorker(pool, w, false);
+            spawnPoolWorker(pool, now_ms);   // verbrauchten Worker gleich ersetzen
         }
         else
+            flushPoolWorker(*w);
+    }
+    else if (job)
+    {
+        flushPoolWorker(*w);
+        Client* c = clients.get(client);
+        if (c && c->cgi == job)
         {
-            closeClient(i);
-            return false;
+            c->last_active_ms = now_ms;
+            touchClient(client.fd, *c);
         }
     }
+    else if (w->eof)
+        retirePoolWorker(pool, w, false);
 
-    return true;
+    runPool(pool, now_ms);
+
+    if (job && job->exited)
+    {
+        Client* c = clients.get(client);
+        if (c && c->cgi == job)
+            finishCgi(client.fd, *c, now_ms);
+    }
+}
+
+void Server::retirePoolWorker(CgiPool& pool, CgiPool::Worker* w, bool kill)
+{
+    reactor->remove(w->sock);
+    pool_fds.erase(w->sock);
+    cgi_orphans.push_back(pool.retire(w, kill));
 }
 
-// poll opens multiple sockets (warteliste)
+void Server::reapIdlePoolWorkers(long now_ms)
+{
+    for (std::map<const LocationConfig*, std::unique_ptr<CgiPool> >::iterator it = cgi_pools.begin(); it != cgi_pools.end(); ++it)
+    {
+        CgiPool& pool = *it->second;
+        long idle_ms = static_cast<long>(pool.location().cgi_pool_idle_ms);
+        if (idle_ms == 0)
+            continue;
+        for (size_t i = 0; i < pool.workers.size(); )
+        {
+            CgiPool::Worker* w = pool.workers[i].get();
+            if (!w->job && now_ms - w->idle_since >= idle_ms)
+                retirePoolWorker(pool, w, false);   // tauscht mit dem letzten
+            else
+                ++i;
+        }
+    }
+}
+
+// ms bis der naechste freie Worker sein idle-Limit erreicht (-1 = keiner)
+int Server::poolTimeout(long now_ms) const
+{
+    long next = -1;
+    for (std::map<const LocationConfig*, std::unique_ptr<CgiPool> >::const_iterator it = cgi_pools.begin(); it != cgi_pools.end(); ++it)
+    {
+        const CgiPool& pool = *it->second;
+        long idle_ms = static_cast<long>(pool.location().cgi_pool_idle_ms);
+        if (idle_ms == 0)
+            continue;
+        for (size_t i = 0; i < pool.workers.size(); ++i)
+        {
+            const CgiPool::Worker& w = *pool.workers[i];
+            if (w.job)
+                continue;
+            long left = std::max(0L, w.idle_since + idle_ms - now_ms);
+            if (next < 0 || left < next)
+                next = left;
+        }
+    }
+    return static_cast<int>(next);
+}
+
+// CPU fuer Worker i laut worker_cpu_affinity (-1 = nicht pinnen)
+static int worker_cpu(int worker_id)
+{
+    if (g_cfg.worker_cpu_auto)
+    {
+        unsigned ncpu = std::thread::hardware_concurrency();
+        return ncpu ? static_cast<int>(worker_id % ncpu) : -1;
+    }
+    if (g_cfg.worker_cpus.empty())
+        return -1;
+    return g_cfg.worker_cpus[worker_id % g_cfg.worker_cpus.size()];
+}
+
+static void pin_to_cpu(int worker_id)
+{
+#ifdef __linux__
+    int cpu = worker_cpu(worker_id);
+    if (cpu < 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        std::cerr << "worker " << worker_id << ": cannot pin to cpu " << cpu << "\n";
+#else
+    (void)worker_id;
+#endif
+}
+
+static void worker_main(int worker_id)
+{
+    Server worker(worker_id, true);
+    worker.serve();
+}
+
+// Config laden, Defaults setzen, dann einen oder mehrere Worker starten
 int Server::run(int argc, char* argv[])
 {
     loadConfig(argc, argv);
@@ -568,74 +1452,245 @@ int Server::run(int argc, char* argv[])
         }
     }
 
+    if (g_cfg.worker_threads == 0)
+        g_cfg.worker_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (g_cfg.worker_processes == 0)
+        g_cfg.worker_processes = std::max(1u, std::thread::hardware_concurrency());
+
+    if (g_cfg.worker_processes > 1)
+    {
+        if (g_cfg.worker_threads > 1)
+            std::cerr << "worker_threads ignored: worker_processes is set\n";
+        g_cfg.worker_threads = 1;
+        return runMaster();
+    }
+
+    // g_cfg ist ab hier read-only -> Threads duerfen ohne Locks lesen
+    if (g_cfg.worker_threads == 1)
+        return serve();
+
+    std::cout << "Starting " << g_cfg.worker_threads << " worker threads\n";
+    reuse_port = true;
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < g_cfg.worker_threads; ++i)
+        workers.push_back(std::thread(worker_main, static_cast<int>(i)));
+    int ret = serve();  // Worker 0 laeuft im Haupt-Thread
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    return ret;
+}
+
+static void master_signal(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+// forkt Worker i; Kind laeuft den Event-Loop und kommt nie zurueck
+static pid_t spawn_worker(int worker_id)
+{
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+#ifdef __linux__
+    prctl(PR_SET_PDEATHSIG, SIGTERM);  // Master weg -> Worker auch
+#endif
+    Server worker(worker_id, false);
+    _exit(worker.serve());
+}
+
+// Master: bindet die Listener einmal, forkt N Worker, startet abgestuerzte neu.
+// SIGTERM/SIGINT/SIGQUIT an den Master -> an alle Worker weiterreichen und beenden.
+int Server::runMaster()
+{
+    for (size_t s = 0; s < g_cfg.servers.size(); ++s)
+    {
+        int port = g_cfg.servers[s].listen_port;
+        if (inherited_listeners.count(port))
+            continue;
+        int lfd = open_listener(port, false);
+        if (lfd < 0)
+        {
+            std::cerr << "[MASTER] cannot listen on port " << port << "\n";
+            return 1;
+        }
+        inherited_listeners[port] = lfd;
+        std::cout << "Listening on 0.0.0.0:" << port << "\n";
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = master_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;  // kein SA_RESTART -> waitpid kommt mit EINTR zurueck
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGQUIT, &sa, NULL);
+
+    std::vector<pid_t> pids(g_cfg.worker_processes, -1);
+    std::vector<long>  started(g_cfg.worker_processes, 0);
+    for (size_t i = 0; i < pids.size(); ++i)
+    {
+        pids[i] = spawn_worker(static_cast<int>(i));
+        started[i] = monotonic_ms();
+    }
+    std::cout << "[MASTER] pid " << getpid() << ", " << pids.size() << " worker processes\n";
+
+    while (!g_stop)
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        size_t i = std::find(pids.begin(), pids.end(), pid) - pids.begin();
+        if (i == pids.size())
+            continue;  // kein Worker (z.B. verwaister CGI-Enkel)
+
+        if (WIFSIGNALED(status))
+            std::cerr << "[MASTER] worker " << i << " (pid " << pid << ") killed by signal " << WTERMSIG(status);
+        else
+            std::cerr << "[MASTER] worker " << i << " (pid " << pid << ") exited with " << WEXITSTATUS(status);
+        if (g_stop)
+        {
+            std::cerr << "\n";
+            pids[i] = -1;
+            break;
+        }
+        std::cerr << " → restarting\n";
+
+        // stirbt ein Worker direkt nach dem Start, nicht im Kreis forken
+        if (monotonic_ms() - started[i] < 1000)
+            sleep(1);
+        pids[i] = spawn_worker(static_cast<int>(i));
+        started[i] = monotonic_ms();
+    }
+
+    std::cout << "[MASTER] shutting down\n";
+    for (size_t i = 0; i < pids.size(); ++i)
+        if (pids[i] > 0)
+            kill(pids[i], SIGTERM);
+    for (size_t i = 0; i < pids.size(); ++i)
+        if (pids[i] > 0)
+            waitpid(pids[i], NULL, 0);
+    for (std::unordered_map<int, int>::iterator it = inherited_listeners.begin(); it != inherited_listeners.end(); ++it)
+        ::close(it->second);
+    return 0;
+}
+
+// reactor (poll/epoll) wartet auf alle sockets (warteliste)
+int Server::serve()
+{
+    pin_to_cpu(worker_id);
+
+    reactor.reset(Reactor::create(g_cfg.event_backend));
+    if (worker_id == 0)
+        std::cout << "Event backend: " << reactor->name() << "\n";
+
     setupListeners();
+    startCgiPools(monotonic_ms());
 
-    const long IDLE_MS = g_cfg.keepalive_timeout_ms;
     char buf[4096];
+    std::vector<IoReady> ready;
+    int poll_fail = 0;
 
     while (1)
     {
-        // time
-        using clock_t = std::chrono::steady_clock;
-        using ms      = std::chrono::milliseconds;
-
-        long now_ms = std::chrono::duration_cast<ms>(clock_t::now().time_since_epoch()).count();
-        handleTimeouts(now_ms, IDLE_MS);
-
-        // poll
-        static int poll_fail = 0;
-        int ready = poll(&fds[0], fds.size(), 1000);
-        if (ready < 0)
+        // wait: bis zur naechsten faelligen Deadline (oder unendlich);
+        // beendete CGI-Prozesse werden alle 10ms abgeholt, freie Pool-Worker
+        // nach ihrem idle-Limit beendet
+        long before_ms = monotonic_ms();
+        int timeout = timers.nextTimeout(before_ms);
+        if ((!cgi_waiting.empty() || !cgi_orphans.empty() || !cgi_heads.empty()) && (timeout < 0 || timeout > 10))
+            timeout = 10;
+        int pool_timeout = poolTimeout(before_ms);
+        if (pool_timeout >= 0 && (timeout < 0 || timeout > pool_timeout))
+            timeout = pool_timeout;
+        int n = reactor->wait(ready, timeout);
+        long now_ms = monotonic_ms();
+        if (n < 0)
         {
-            if (++poll_fail > 1000)
+            if (errno != EINTR && ++poll_fail > 1000)
                 break;
             continue;
         }
         poll_fail = 0;
 
         // handle events
-        for (size_t i = 0; i < fds.size(); ++i)
+        for (size_t i = 0; i < ready.size(); ++i)
         {
-            short re = fds[i].revents;
-            if (re == 0)
+            int fd = ready[i].fd;
+            unsigned re = ready[i].events;
+
+            // listener: accept new clients
+            if (listener_fds.find(fd) != listener_fds.end())
+            {
+                handleListenerEvent(fd, now_ms);
                 continue;
-            fds[i].revents = 0;
+            }
 
-            int fd = fds[i].fd;
-            bool is_listener = (listener_fds.find(fd) != listener_fds.end());
+            // stdin/stdout-Pipe eines CGI-Scripts
+            if (cgi_fds.count(fd))
+            {
+                handleCgiEvent(fd, now_ms);
+                continue;
+            }
 
-            // listener: accept new clients
-            if (is_listener)
+            // Verbindung zu einem FastCGI-Backend
+            if (fcgi_fds.count(fd))
             {
-                handleListenerEvent(i, now_ms);
+                handleFcgiEvent(fd, re, now_ms);
                 continue;
             }
 
-            // error/hangup on client fd
-            if (re & (POLLHUP | POLLERR | POLLNVAL))
+            // socketpair zu einem cgi_pool-Worker
+            if (pool_fds.count(fd))
             {
-                closeClient(i);
+                handlePoolEvent(fd, re, now_ms);
                 continue;
             }
 
-            // read
-            if (re & POLLIN)
+            // schon geschlossen (frueheres Event in dieser Runde)
+            if (!clients.get(fd))
+                continue;
+
+            // read (auch bei HUP: restliche Bytes / EOF abholen)
+            if (re & IO_READ)
             {
-                if (!handleClientRead(i, now_ms, buf, sizeof(buf)))
+                if (!handleClientRead(fd, now_ms, buf, sizeof(buf)))
                     continue;
             }
 
+            // error/hangup on client fd
+            if (re & IO_ERROR)
+            {
+                closeClient(fd);
+                continue;
+            }
+
             // write
-            if (re & POLLOUT)
+            if (re & IO_WRITE)
             {
-                if (!handleClientWrite(i, now_ms))
+                if (!handleClientWrite(fd, now_ms))
                     continue;
             }
         }
+
+        reapCgi(now_ms);
+        reapIdlePoolWorkers(now_ms);
+        handleTimeouts(now_ms);
     }
 
-    for (auto &p : fds)
-        ::close(p.fd);
+    for (size_t i = 0; i < clients.active().size(); ++i)
+        ::close(clients.active()[i]);
+    for (std::unordered_set<int>::iterator it = listener_fds.begin(); it != listener_fds.end(); ++it)
+        ::close(*it);
     return 0;
 }
-
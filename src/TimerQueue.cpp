@@ -0,0 +1,34 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerQueue.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:40:05 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 11:40:05 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "TimerQueue.hpp"
+#include <climits>
+
+void TimerQueue::push(long deadline_ms, const ConnHandle& h)
+{
+    TimerEntry e;
+    e.deadline_ms = deadline_ms;
+    e.conn = h;
+    heap.push(e);
+}
+
+int TimerQueue::nextTimeout(long now_ms) const
+{
+    if (heap.empty())
+        return -1;
+    long d = heap.top().deadline_ms - now_ms;
+    if (d <= 0)
+        return 0;
+    if (d > INT_MAX)
+        return INT_MAX;
+    return static_cast<int>(d);
+}
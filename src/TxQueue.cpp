@@ -0,0 +1,204 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TxQueue.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 13:21:50 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 13:21:50 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "TxQueue.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
+
+#ifndef IOV_MAX
+# define IOV_MAX 1024
+#endif
+
+static const int TX_IOV = (IOV_MAX < 64) ? IOV_MAX : 64;
+// so viele gesendete Puffer (bis SPARE_MAX Kapazitaet) bleiben fuer buffer() liegen
+static const size_t SPARE_COUNT = 4;
+static const size_t SPARE_MAX   = 16384;
+
+std::string TxQueue::buffer()
+{
+    std::string s;
+    if (!spare.empty())
+    {
+        s.swap(spare.back());
+        spare.pop_back();
+    }
+    return s;
+}
+
+// laeuft die Queue nie ganz leer (Pipelining), wird vorn ab und zu aufgeraeumt
+TxSegment& TxQueue::append()
+{
+    if (head > 0 && head * 2 >= segs.size())
+    {
+        segs.erase(segs.begin(), segs.begin() + head);
+        head = 0;
+    }
+    segs.emplace_back();
+    return segs.back();
+}
+
+void TxQueue::pushData(std::string data)
+{
+    if (data.empty())
+        return;
+    pending += data.size();
+    append().data.swap(data);
+}
+
+void TxQueue::pushShared(const std::shared_ptr<const std::string>& data)
+{
+    if (!data || data->empty())
+        return;
+    pending += data->size();
+    append().shared = data;
+}
+
+void TxQueue::pushFile(const std::shared_ptr<FileRef>& file, off_t off, size_t len)
+{
+    if (!file || len == 0)
+        return;
+    pending += len;
+    TxSegment& seg = append();
+    seg.file = file;
+    seg.file_off = off;
+    seg.file_left = len;
+}
+
+void TxQueue::endResponse()
+{
+    if (!empty())
+        segs.back().last = true;
+}
+
+size_t TxQueue::takeCompleted()
+{
+    size_t n = completed;
+    completed = 0;
+    return n;
+}
+
+void TxQueue::clear()
+{
+    segs.clear();
+    head = 0;
+    pending = 0;
+    completed = 0;
+}
+
+void TxQueue::popFront()
+{
+    TxSegment& seg = segs[head];
+    if (seg.last)
+        ++completed;
+    if (seg.data.capacity() <= SPARE_MAX && spare.size() < SPARE_COUNT)
+    {
+        seg.data.clear();
+        spare.push_back(std::string());
+        spare.back().swap(seg.data);
+    }
+    seg = TxSegment();   // file/shared loslassen
+    if (++head == segs.size())
+    {
+        segs.clear();
+        head = 0;
+    }
+}
+
+// alle Speicher-Segmente bis zum naechsten Dateisegment in einem writev()
+ssize_t TxQueue::writeData(int fd)
+{
+    struct iovec iov[TX_IOV];
+    int n = 0;
+    for (size_t i = head; i < segs.size() && n < TX_IOV; ++i)
+    {
+        if (segs[i].file)
+            break;
+        const std::string& d = segs[i].bytes();
+        iov[n].iov_base = const_cast<char*>(d.data()) + segs[i].off;
+        iov[n].iov_len  = d.size() - segs[i].off;
+        ++n;
+    }
+
+    ssize_t m = ::writev(fd, iov, n);
+    if (m <= 0)
+        return m;
+
+    size_t left = static_cast<size_t>(m);
+    while (left > 0)
+    {
+        TxSegment& seg = segs[head];
+        size_t rest = seg.bytes().size() - seg.off;
+        if (left < rest)
+        {
+            seg.off += left;
+            break;
+        }
+        left -= rest;
+        popFront();
+    }
+    pending -= static_cast<size_t>(m);
+    return m;
+}
+
+// Dateiabschnitt direkt vom Page-Cache in den Socket
+ssize_t TxQueue::writeFile(int fd, TxSegment& seg)
+{
+    size_t want = std::min(seg.file_left, static_cast<size_t>(1 << 20));
+#ifdef __linux__
+    ssize_t m = ::sendfile(fd, seg.file->fd, &seg.file_off, want);
+#else
+    char buf[16384];
+    ssize_t m = ::pread(seg.file->fd, buf, std::min(want, sizeof(buf)), seg.file_off);
+    if (m > 0)
+    {
+        m = ::write(fd, buf, m);
+        if (m > 0)
+            seg.file_off += m;
+    }
+#endif
+    if (m <= 0)
+        return m;
+
+    seg.file_left -= static_cast<size_t>(m);
+    pending -= static_cast<size_t>(m);
+    if (seg.file_left == 0)
+        popFront();
+    return m;
+}
+
+TxQueue::Result TxQueue::flush(int fd, size_t& sent)
+{
+    sent = 0;
+    while (!empty())
+    {
+        ssize_t m = segs[head].file ? writeFile(fd, segs[head]) : writeData(fd);
+
+        if (m > 0)
+        {
+            sent += static_cast<size_t>(m);
+            continue;
+        }
+        if (m < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return TX_AGAIN;
+        if (m < 0 && errno == EINTR)
+            continue;
+        // m == 0 bei sendfile: Datei wurde gekuerzt -> Content-Length nicht haltbar
+        return TX_ERROR;
+    }
+    return TX_DONE;
+}
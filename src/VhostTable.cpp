@@ -0,0 +1,82 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VhostTable.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 22:58:06 by mhummel           #+#    #+#             */
+/*   Updated: 2026/10/18 22:58:06 by mhummel          ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "VhostTable.hpp"
+#include "config.hpp"
+#include <cctype>
+
+static std::string lower(const std::string& s)
+{
+    std::string out(s);
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(out[i])));
+    return out;
+}
+
+void VhostTable::add(size_t idx, const ServerConfig& sc)
+{
+    if (!has_default || (sc.default_server && !has_default_flag))
+    {
+        default_idx = idx;
+        has_default = true;
+        has_default_flag = sc.default_server;
+    }
+    for (size_t i = 0; i < sc.server_names.size(); ++i)
+    {
+        std::string name = lower(sc.server_names[i]);
+        if (name.empty())
+            continue;
+        if (name.compare(0, 2, "*.") == 0)
+            head_wild.insert(std::make_pair(name.substr(1), idx));
+        else if (name[0] == '.')
+        {
+            exact.insert(std::make_pair(name.substr(1), idx));
+            head_wild.insert(std::make_pair(name, idx));
+        }
+        else if (name.size() > 2 && name.compare(name.size() - 2, 2, ".*") == 0)
+            tail_wild.insert(std::make_pair(name.substr(0, name.size() - 1), idx));
+        else
+            exact.insert(std::make_pair(name, idx));
+    }
+}
+
+size_t VhostTable::find(const std::string& raw) const
+{
+    // Port ab ("[::1]:8080" -> "[::1]"), Punkt am Ende ab, klein
+    size_t end = raw.size();
+    size_t colon = raw.rfind(':');
+    if (colon != std::string::npos && raw.find(']', colon) == std::string::npos)
+        end = colon;
+    if (end > 0 && raw[end - 1] == '.')
+        --end;
+    if (end == 0)
+        return default_idx;
+    std::string host = lower(raw.substr(0, end));
+
+    std::unordered_map<std::string, size_t>::const_iterator it = exact.find(host);
+    if (it != exact.end())
+        return it->second;
+
+    // "a.b.example.com": ".b.example.com", ".example.com", ".com" (laengster zuerst)
+    if (!head_wild.empty())
+        for (size_t dot = host.find('.'); dot != std::string::npos; dot = host.find('.', dot + 1))
+            if ((it = head_wild.find(host.substr(dot))) != head_wild.end())
+                return it->second;
+
+    // "www.example.com": "www.example.", "www." (laengster zuerst)
+    if (!tail_wild.empty())
+        for (size_t dot = host.rfind('.'); dot != std::string::npos && dot > 0; dot = host.rfind('.', dot - 1))
+            if ((it = tail_wild.find(host.substr(0, dot + 1))) != tail_wild.end())
+                return it->second;
+
+    return default_idx;
+}
@@ -124,6 +124,28 @@ void Config::parseLocationBlock(std::ifstream& file, int& lineNum,
 		else if (key == "autoindex" && !params.empty()) currentLocation->autoindex = (params[0] == "on");
 		else if (key == "methods" && !params.empty()) currentLocation->methods = params;
 		else if (key == "cgi" && params.size() >= 2) currentLocation->cgi[params[0]] = params[1];
+		else if (key == "fastcgi" && !params.empty()) {
+			currentLocation->fastcgi = params[0];
+			currentLocation->fastcgi_mpx = (params.size() >= 2 && params[1] == "multiplex");
+		}
+		else if (key == "cgi_pool" && !params.empty()) {
+			currentLocation->cgi_pool = std::strtoul(params[0].c_str(), NULL, 10);
+			if (params.size() >= 2) currentLocation->cgi_pool_max_requests = std::strtoul(params[1].c_str(), NULL, 10);
+			if (params.size() >= 3) currentLocation->cgi_pool_idle_ms = parseTime(params[2]);
+		}
+		else if (key == "gzip_static" && !params.empty()) currentLocation->gzip_static = (params[0] == "on");
+		else if (key == "brotli_static" && !params.empty()) currentLocation->brotli_static = (params[0] == "on");
+		else if (key == "gzip" && !params.empty()) currentLocation->gzip = (params[0] == "on");
+		else if (key == "gzip_types" && !params.empty()) {
+			currentLocation->gzip_types = params;
+			currentLocation->gzip_types.push_back("text/html");
+		}
+		else if (key == "gzip_min_length" && !params.empty()) currentLocation->gzip_min_length = parseSize(params[0]);
+		else if (key == "gzip_comp_level" && !params.empty()) {
+			currentLocation->gzip_comp_level = std::atoi(params[0].c_str());
+			if (currentLocation->gzip_comp_level < 1 || currentLocation->gzip_comp_level > 9)
+				throw std::runtime_error("gzip_comp_level must be 1..9");
+		}
 		else if (key == "data_store" && !params.empty()) currentLocation->data_store = params[0];
 		else if (key == "client_max_body_size" && !params.empty()) currentLocation->client_max_body_size = parseSize(params[0]);
 		else if (key == "error_page" && params.size() >= 2) {
@@ -154,6 +176,41 @@ void Config::resolveVariables() {
 	}
 }
 
+// Was fuer alle CGI-Requests einer Location gleich ist, liegt fertig vor;
+// pro Request kommen nur Methode, Pfade, Query und Laenge dazu
+void Config::buildCgiEnv() {
+	for (auto& server : servers) {
+		for (auto& loc : server.locations) {
+			loc.cgi_env = {
+				"GATEWAY_INTERFACE=CGI/1.1",
+				"SERVER_PROTOCOL=HTTP/1.1",
+				"SERVER_SOFTWARE=webserv/1.0",
+				"REDIRECT_STATUS=200",
+				"SERVER_NAME=" + server.server_name,
+				"SERVER_PORT=" + std::to_string(server.listen_port),
+				"DOCUMENT_ROOT=" + loc.root,
+			};
+		}
+	}
+}
+
+// Routing einmal vorberechnen: Trie ueber die location-Pfade, dazu pro Location
+// das Dateisystem-Root und wie viel vom URL-Pfad davor abgeschnitten wird
+void Config::buildRoutes() {
+	for (auto& server : servers) {
+		for (auto& loc : server.locations) {
+			loc.fs_root = loc.root.empty() ? std::string(".") : loc.root;
+			loc.strip_len = (loc.path.empty() || loc.path == "/") ? 0 : loc.path.size();
+		}
+		server.routes.build(server.locations);
+	}
+}
+
+void Config::finalize() {
+	buildCgiEnv();
+	buildRoutes();
+}
+
 void Config::parse_c(const std::string& filename) {
 	std::ifstream file(filename.c_str());
 	if (!file.is_open()) throw std::runtime_error("Cannot open config file: " + filename);
@@ -229,6 +286,55 @@ void Config::parse_c(const std::string& filename) {
 			else if (key == "keepalive_timeout" && !params.empty()) {
     g_cfg.keepalive_timeout_ms = parseTime(params[0]);
 }
+			else if (key == "client_header_timeout" && !params.empty())
+				header_timeout_ms = parseTime(params[0]);
+			else if (key == "client_body_timeout" && !params.empty())
+				body_timeout_ms = parseTime(params[0]);
+			else if (key == "send_timeout" && !params.empty())
+				send_timeout_ms = parseTime(params[0]);
+			else if (key == "worker_processes" && !params.empty()) {
+				if (params[0] == "auto")
+					worker_processes = 0;
+				else if (std::atoi(params[0].c_str()) < 1)
+					throw std::runtime_error("worker_processes must be >= 1 or 'auto'");
+				else
+					worker_processes = std::atoi(params[0].c_str());
+			}
+			else if (key == "worker_threads" && !params.empty()) {
+				if (params[0] == "auto")
+					worker_threads = 0;   // wird beim Start auf hardware_concurrency gesetzt
+				else if (std::atoi(params[0].c_str()) < 1)
+					throw std::runtime_error("worker_threads must be >= 1 or 'auto'");
+				else
+					worker_threads = std::atoi(params[0].c_str());
+			}
+			else if (key == "worker_cpu_affinity" && !params.empty()) {
+				worker_cpus.clear();
+				worker_cpu_auto = (params[0] == "auto");
+				if (!worker_cpu_auto && params[0] != "off") {
+					for (size_t i = 0; i < params.size(); ++i)
+						worker_cpus.push_back(std::atoi(params[i].c_str()));
+				}
+			}
+			else if (key == "event_backend" && !params.empty()) {
+				if (params[0] != "epoll" && params[0] != "poll")
+					throw std::runtime_error("event_backend must be 'epoll' or 'poll'");
+				event_backend = params[0];
+			}
+			else if (key == "open_file_cache" && !params.empty()) {
+				open_file_cache_max = (params[0] == "off") ? 0 : std::strtoul(params[0].c_str(), NULL, 10);
+				if (params.size() >= 2)
+					open_file_cache_inactive_ms = parseTime(params[1]);
+			}
+			else if (key == "open_file_cache_valid" && !params.empty())
+				open_file_cache_valid_ms = parseTime(params[0]);
+			else if (key == "open_file_cache_errors" && !params.empty())
+				open_file_cache_errors = (params[0] == "on");
+			else if (key == "pipeline_depth" && !params.empty()) {
+				if (std::atoi(params[0].c_str()) < 1)
+					throw std::runtime_error("pipeline_depth must be >= 1");
+				pipeline_depth = std::atoi(params[0].c_str());
+			}
 		}
 		else if (contextStack.back() == SERVER && currentServer) {
 			if (key == "listen" && !params.empty()) {
@@ -240,16 +346,26 @@ void Config::parse_c(const std::string& filename) {
 					currentServer->listen_host = params[0].substr(0, colon);
 					currentServer->listen_port = std::atoi(params[0].substr(colon + 1).c_str());
 				}
+				if (params.size() >= 2 && params[1] == "default_server")
+					currentServer->default_server = true;
 			}
-			else if (key == "server_name" && !params.empty())
+			else if (key == "server_name" && !params.empty()) {
 				currentServer->server_name = params[0];
+				currentServer->server_names = params;
+			}
 			else if (key == "client_max_body_size" && !params.empty()) {
 				currentServer->client_max_body_size = parseSize(params[0]);
 			}
+			else if (key == "content_cache" && !params.empty()) {
+				currentServer->content_cache_size = (params[0] == "off") ? 0 : parseSize(params[0]);
+				if (params.size() >= 2)
+					currentServer->content_cache_max_file = parseSize(params[1]);
+			}
 		}
 	}
 
 	resolveVariables();
+	finalize();
 	// ────────────────────── VALIDIERUNG AM ENDE ──────────────────────
 	if (servers.empty()) {
 		throw std::runtime_error("No 'server {}' block found in config file");
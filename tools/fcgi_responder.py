@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# Kleiner FastCGI-Responder zum Testen der "fastcgi"-Location-Direktive.
+# Fuehrt .py-Scripts (SCRIPT_FILENAME) im selben, langlebigen Interpreter aus
+# und beherrscht gemultiplexte Requests (FCGI_KEEP_CONN, mehrere IDs).
+#
+#   python3 tools/fcgi_responder.py unix:/tmp/webserv-fcgi.sock
+#   python3 tools/fcgi_responder.py 127.0.0.1:9000
+#
+# webserv.conf:  location /root/cgi-bin { ... fastcgi unix:/tmp/webserv-fcgi.sock multiplex; }
+
+import contextlib, io, os, runpy, selectors, socket, struct, sys, traceback
+
+BEGIN, ABORT, END, PARAMS, STDIN, STDOUT, STDERR = 1, 2, 3, 4, 5, 6, 7
+
+def record(rtype, rid, data=b''):
+    out = b''
+    for off in range(0, max(len(data), 1), 65535):
+        chunk = data[off:off + 65535]
+        pad = (8 - len(chunk) % 8) % 8
+        out += struct.pack('>BBHHBx', 1, rtype, rid, len(chunk), pad) + chunk + b'\0' * pad
+    return out
+
+def decode_params(data):
+    env, i = {}, 0
+    def length():
+        nonlocal i
+        if data[i] < 128:
+            i += 1
+            return data[i - 1]
+        n = struct.unpack('>I', data[i:i + 4])[0] & 0x7fffffff
+        i += 4
+        return n
+    while i < len(data):
+        kl = length(); vl = length()
+        env[data[i:i + kl].decode()] = data[i + kl:i + kl + vl].decode(errors='replace')
+        i += kl + vl
+    return env
+
+def run_script(env, body):
+    path = env.get('SCRIPT_FILENAME', '')
+    if not path.endswith('.py') or not os.path.isfile(path):
+        return b'Status: 404 Not Found\r\nContent-Type: text/html\r\n\r\n<h1>404 Not Found</h1>', b''
+    out, err = io.StringIO(), b''
+    old_cwd, old_env, old_stdin = os.getcwd(), dict(os.environ), sys.stdin
+    try:
+        os.chdir(os.path.dirname(path))
+        os.environ.update(env)
+        sys.stdin = io.TextIOWrapper(io.BytesIO(body))
+        with contextlib.redirect_stdout(out):
+            runpy.run_path(path, run_name='__main__')
+    except SystemExit:
+        pass
+    except Exception:
+        err = traceback.format_exc().encode()
+        return b'Status: 500 Internal Server Error\r\nContent-Type: text/html\r\n\r\n<h1>500</h1>', err
+    finally:
+        os.chdir(old_cwd)
+        os.environ.clear(); os.environ.update(old_env)
+        sys.stdin = old_stdin
+    text = out.getvalue()
+    head = text.split('\n', 1)[0]
+    if ':' not in head or '<' in head:      # Script ohne Header-Block
+        text = 'Content-Type: text/html\r\n\r\n' + text
+    return text.encode(), err
+
+class Conn:
+    def __init__(self, sock):
+        self.sock, self.buf, self.reqs = sock, b'', {}
+
+    def feed(self, data):
+        self.buf += data
+        out = b''
+        while len(self.buf) >= 8:
+            _, rtype, rid, clen, pad = struct.unpack('>BBHHBx', self.buf[:8])
+            if len(self.buf) < 8 + clen + pad:
+                break
+            content, self.buf = self.buf[8:8 + clen], self.buf[8 + clen + pad:]
+            if rtype == BEGIN:
+                self.reqs[rid] = {'params': b'', 'stdin': b''}
+            elif rtype == ABORT and rid in self.reqs:
+                del self.reqs[rid]
+                out += record(END, rid, struct.pack('>IB3x', 1, 0))
+            elif rtype == PARAMS and rid in self.reqs:
+                self.reqs[rid]['params'] += content
+            elif rtype == STDIN and rid in self.reqs:
+                if content:
+                    self.reqs[rid]['stdin'] += content
+                    continue
+                req = self.reqs.pop(rid)
+                body, err = run_script(decode_params(req['params']), req['stdin'])
+                out += record(STDOUT, rid, body) + record(STDOUT, rid)
+                if err:
+                    out += record(STDERR, rid, err)
+                out += record(END, rid, struct.pack('>IB3x', 0, 0))
+        return out
+
+def main():
+    addr = sys.argv[1] if len(sys.argv) > 1 else 'unix:/tmp/webserv-fcgi.sock'
+    if addr.startswith('unix:'):
+        path = addr[5:]
+        with contextlib.suppress(FileNotFoundError):
+            os.unlink(path)
+        srv = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        srv.bind(path)
+    else:
+        host, port = addr.rsplit(':', 1)
+        srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        srv.bind((host, int(port)))
+    srv.listen(128)
+    srv.setblocking(False)
+    sel = selectors.DefaultSelector()
+    sel.register(srv, selectors.EVENT_READ)
+    print('fcgi responder on', addr, flush=True)
+    while True:
+        for key, _ in sel.select():
+            if key.fileobj is srv:
+                s, _ = srv.accept()
+                sel.register(s, selectors.EVENT_READ, Conn(s))
+                continue
+            conn = key.data
+            try:
+                data = conn.sock.recv(65536)
+            except ConnectionError:
+                data = b''
+            if not data:
+                sel.unregister(conn.sock)
+                conn.sock.close()
+                continue
+            reply = conn.feed(data)
+            if reply:
+                conn.sock.setblocking(True)
+                conn.sock.sendall(reply)
+                conn.sock.setblocking(False)
+
+if __name__ == '__main__':
+    main()